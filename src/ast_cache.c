@@ -0,0 +1,524 @@
+#include "ast_cache.h"
+
+#include "error.h"
+#include "file_io.h"
+#include "parser.h"
+#include "vector.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* "LIVC" */
+#define AST_CACHE_MAGIC 0x4356494c
+/* bumped whenever the layout or the meaning of a node changes */
+#define AST_CACHE_VERSION 2
+#define AST_CACHE_NO_CHILDREN 0xffffffff
+#define AST_CACHE_NO_STRING 0xffffffffffffffff
+#define AST_CACHE_STRINGS_DEFAULT_CAPACITY 4096
+
+/* the file is the header, the dependencies, the nodes, the bodies and the
+ * strings */
+typedef struct ASTCacheHeader {
+  u32 magic;
+  u32 version;
+  /* node numbering the tree was written with */
+  u32 node_types;
+  u32 dependency_count;
+  u64 source_hash;
+  u64 node_count;
+  u64 body_count;
+  u64 strings_size;
+} ASTCacheHeader;
+
+/* an imported file, path is an offset into the strings */
+typedef struct ASTCacheDependency {
+  u64 path;
+  u64 hash;
+} ASTCacheDependency;
+
+/* one node in preorder, its children follow it. for nodes holding a string
+ * the value is an offset into the strings, for a lazy block it is the
+ * index of its body */
+typedef struct ASTCacheNode {
+  u8 type;
+  u8 reserved[3];
+  u32 line;
+  u32 child_count;
+  u32 padding;
+  u64 value;
+} ASTCacheNode;
+
+/* an unparsed function body, the span of its text from the opening brace.
+ * source is 0 for the file itself and i + 1 for its ith dependency */
+typedef struct ASTCacheBody {
+  u64 offset;
+  u64 length;
+  u32 line;
+  u32 source;
+  u8 yields;
+  u8 reserved[7];
+} ASTCacheBody;
+
+typedef struct ASTCacheWriter {
+  ASTCacheNode *nodes;
+  ASTCacheBody *bodies;
+  char *strings;
+  u64 strings_size;
+  u64 strings_capacity;
+  /* where the bodies can point into */
+  const char *source;
+  char **imports;
+} ASTCacheWriter;
+
+typedef struct ASTCacheReader {
+  ASTCacheNode *nodes;
+  u64 node_count;
+  ASTCacheBody *bodies;
+  u64 body_count;
+  char *strings;
+  u64 strings_size;
+  u64 cursor;
+  /* the file itself and its dependencies, by body source */
+  const char **sources;
+  ParserBody ***out_bodies;
+} ASTCacheReader;
+
+static u64 ASTCacheHash(const char *data, u64 length);
+static b8 ASTCacheHasString(u8 type);
+static u64 ASTCacheWriteString(ASTCacheWriter *writer, const char *string);
+static void ASTCacheWriteNode(ASTCacheWriter *writer, ASTNode *node);
+static b8 ASTCacheWriteBody(ASTCacheWriter *writer, ParserBody *body);
+static b8 ASTCacheCheckNode(ASTCacheReader *reader);
+static b8 ASTCacheCheckBodies(ASTCacheReader *reader, FileView *imports,
+                              u64 length);
+static ASTNode ASTCacheReadNode(ASTCacheReader *reader);
+static b8 ASTCacheFileHash(const char *path, u64 *out_hash);
+static b8 ASTCacheWriteAll(i32 fd, const void *data, u64 size);
+
+b8 ASTCachePath(const char *source_path, char *out_path, u64 size) {
+  char *enabled = getenv("LIV_CACHE");
+  if (enabled && !strcmp(enabled, "0")) {
+    return false;
+  }
+
+  char *directory = getenv("LIV_CACHE_DIR");
+  if (!directory) {
+    return snprintf(out_path, size, "%sc", source_path) < size;
+  }
+
+  /* one directory for every source, named by the full path */
+  char resolved[PATH_MAX];
+  const char *path = realpath(source_path, resolved) ? resolved : source_path;
+  u64 hash = ASTCacheHash(path, strlen(path));
+
+  return snprintf(out_path, size, "%s/%016lx.livc", directory, hash) < size;
+}
+
+b8 ASTCacheLoad(const char *cache_path, const char *source, u64 length,
+                ASTNode *out_root, ASTCache *out_cache) {
+  i32 fd = open(cache_path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) || info.st_size < sizeof(ASTCacheHeader)) {
+    close(fd);
+    return false;
+  }
+
+  u64 size = info.st_size;
+  char *mapping = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  ASTCacheHeader *header = (ASTCacheHeader *)mapping;
+  b8 valid = header->magic == AST_CACHE_MAGIC &&
+             header->version == AST_CACHE_VERSION &&
+             header->node_types == AST_NODE_TYPE_MAX &&
+             header->source_hash == ASTCacheHash(source, length);
+
+  /* the sections have to fill the file exactly */
+  u64 dependencies_size =
+      (u64)header->dependency_count * sizeof(ASTCacheDependency);
+  u64 nodes_size = header->node_count * sizeof(ASTCacheNode);
+  u64 bodies_size = header->body_count * sizeof(ASTCacheBody);
+  valid = valid && header->node_count > 0 &&
+          header->node_count < size / sizeof(ASTCacheNode) &&
+          header->body_count < size / sizeof(ASTCacheBody) &&
+          header->strings_size > 0 &&
+          sizeof(ASTCacheHeader) + dependencies_size + nodes_size +
+                  bodies_size + header->strings_size ==
+              size;
+
+  ASTCacheReader reader = {};
+  ASTCacheDependency *dependencies = 0;
+  if (valid) {
+    dependencies =
+        (ASTCacheDependency *)(mapping + sizeof(ASTCacheHeader));
+    reader.nodes =
+        (ASTCacheNode *)(mapping + sizeof(ASTCacheHeader) + dependencies_size);
+    reader.node_count = header->node_count;
+    reader.bodies = (ASTCacheBody *)((char *)reader.nodes + nodes_size);
+    reader.body_count = header->body_count;
+    reader.strings = (char *)reader.bodies + bodies_size;
+    reader.strings_size = header->strings_size;
+    valid = reader.strings[reader.strings_size - 1] == 0;
+  }
+
+  /* an imported file that changed makes the whole tree stale. the files
+   * stay open for the bodies that point into them */
+  FileView *imports = vectorCreate(FileView);
+  for (u32 i = 0; valid && i < header->dependency_count; ++i) {
+    FileView view;
+    valid = dependencies[i].path < reader.strings_size &&
+            fileViewOpen(reader.strings + dependencies[i].path, &view);
+    if (valid) {
+      vectorPush(imports, view);
+      valid = ASTCacheHash(view.data, view.length) == dependencies[i].hash;
+    }
+  }
+
+  if (valid) {
+    valid = ASTCacheCheckNode(&reader) &&
+            reader.cursor == reader.node_count &&
+            ASTCacheCheckBodies(&reader, imports, length);
+  }
+
+  if (!valid) {
+    for (u32 i = 0; i < vectorLength(imports); ++i) {
+      fileViewClose(&imports[i]);
+    }
+    vectorDestroy(imports);
+    munmap(mapping, size);
+    return false;
+  }
+
+  const char *sources[header->dependency_count + 1];
+  sources[0] = source;
+  for (u32 i = 0; i < header->dependency_count; ++i) {
+    sources[i + 1] = imports[i].data;
+  }
+
+  out_cache->mapping = mapping;
+  out_cache->size = size;
+  out_cache->imports = imports;
+  out_cache->paths = vectorReserve(char *, header->dependency_count);
+  for (u32 i = 0; i < header->dependency_count; ++i) {
+    vectorPush(out_cache->paths, reader.strings + dependencies[i].path);
+  }
+  out_cache->bodies = vectorReserve(ParserBody *, reader.body_count + 1);
+
+  reader.cursor = 0;
+  reader.sources = sources;
+  reader.out_bodies = &out_cache->bodies;
+  *out_root = ASTCacheReadNode(&reader);
+
+  return true;
+}
+
+void ASTCacheStore(const char *cache_path, const char *source, u64 length,
+                   ASTNode *root, char **imports) {
+  /* filled in place, so it is intact after a jump back */
+  ASTCacheWriter *writer = calloc(1, sizeof(ASTCacheWriter));
+  writer->nodes = vectorCreate(ASTCacheNode);
+  writer->bodies = vectorCreate(ASTCacheBody);
+  writer->source = source;
+  writer->imports = imports;
+  writer->strings_capacity = AST_CACHE_STRINGS_DEFAULT_CAPACITY;
+  writer->strings = malloc(writer->strings_capacity);
+
+  u32 dependency_count = vectorLength(imports);
+  ASTCacheDependency dependencies[dependency_count + 1];
+  for (u32 i = 0; i < dependency_count; ++i) {
+    dependencies[i].path = ASTCacheWriteString(writer, imports[i]);
+    if (!ASTCacheFileHash(imports[i], &dependencies[i].hash)) {
+      dependencies[i].hash = 0;
+    }
+  }
+
+  /* a body that has to be stored parsed and does not parse is an error for
+   * its first call, there is nothing to store until it is fixed */
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    vectorDestroy(writer->nodes);
+    vectorDestroy(writer->bodies);
+    free(writer->strings);
+    free(writer);
+    return;
+  }
+
+  ASTCacheWriteNode(writer, root);
+  errorTrapPop(&trap);
+
+  ASTCacheHeader header = {};
+  header.magic = AST_CACHE_MAGIC;
+  header.version = AST_CACHE_VERSION;
+  header.node_types = AST_NODE_TYPE_MAX;
+  header.dependency_count = dependency_count;
+  header.source_hash = ASTCacheHash(source, length);
+  header.node_count = vectorLength(writer->nodes);
+  header.body_count = vectorLength(writer->bodies);
+  header.strings_size = writer->strings_size;
+
+  /* written aside and renamed, so a reader never maps a partial file */
+  char temp_path[PATH_MAX];
+  snprintf(temp_path, sizeof(temp_path), "%s.%d.tmp", cache_path, getpid());
+
+  i32 fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    b8 written =
+        ASTCacheWriteAll(fd, &header, sizeof(header)) &&
+        ASTCacheWriteAll(fd, dependencies,
+                         sizeof(ASTCacheDependency) * dependency_count) &&
+        ASTCacheWriteAll(fd, writer->nodes,
+                         sizeof(ASTCacheNode) * header.node_count) &&
+        ASTCacheWriteAll(fd, writer->bodies,
+                         sizeof(ASTCacheBody) * header.body_count) &&
+        ASTCacheWriteAll(fd, writer->strings, writer->strings_size);
+    close(fd);
+
+    if (!written || rename(temp_path, cache_path)) {
+      unlink(temp_path);
+    }
+  }
+
+  vectorDestroy(writer->nodes);
+  vectorDestroy(writer->bodies);
+  free(writer->strings);
+  free(writer);
+}
+
+void ASTCacheRelease(ASTCache *cache) {
+  for (u32 i = 0; i < vectorLength(cache->bodies); ++i) {
+    parserBodyDestroy(cache->bodies[i]);
+  }
+  vectorDestroy(cache->bodies);
+
+  for (u32 i = 0; i < vectorLength(cache->imports); ++i) {
+    fileViewClose(&cache->imports[i]);
+  }
+  vectorDestroy(cache->imports);
+  vectorDestroy(cache->paths);
+
+  munmap(cache->mapping, cache->size);
+}
+
+/* fnv-1a */
+static u64 ASTCacheHash(const char *data, u64 length) {
+  u64 hash = 0xcbf29ce484222325;
+  for (u64 i = 0; i < length; ++i) {
+    hash ^= (u8)data[i];
+    hash *= 0x100000001b3;
+  }
+
+  return hash;
+}
+
+static b8 ASTCacheHasString(u8 type) {
+  return type == AST_NODE_TYPE_IDENT || type == AST_NODE_TYPE_STRLIT ||
+         type == AST_NODE_TYPE_POSTINC || type == AST_NODE_TYPE_POSTDEC;
+}
+
+static u64 ASTCacheWriteString(ASTCacheWriter *writer, const char *string) {
+  u64 length = strlen(string) + 1;
+  while (writer->strings_size + length > writer->strings_capacity) {
+    writer->strings_capacity *= 2;
+    writer->strings = realloc(writer->strings, writer->strings_capacity);
+  }
+
+  u64 offset = writer->strings_size;
+  memcpy(writer->strings + offset, string, length);
+  writer->strings_size += length;
+
+  return offset;
+}
+
+static void ASTCacheWriteNode(ASTCacheWriter *writer, ASTNode *node) {
+  if (node->type == AST_NODE_TYPE_LAZY_BLOCK) {
+    ASTCacheNode record = {};
+    record.type = node->type;
+    record.line = node->line;
+    record.child_count = AST_CACHE_NO_CHILDREN;
+    record.value = vectorLength(writer->bodies);
+    if (ASTCacheWriteBody(writer, node->value.body)) {
+      vectorPush(writer->nodes, record);
+      return;
+    }
+
+    /* a body outside the files of the tree is stored parsed */
+    node = parserBodyBlock(node->value.body);
+  }
+
+  ASTCacheNode record = {};
+  record.type = node->type;
+  record.line = node->line;
+  record.child_count =
+      node->children ? vectorLength(node->children) : AST_CACHE_NO_CHILDREN;
+
+  if (ASTCacheHasString(node->type)) {
+    record.value = node->value.string
+                       ? ASTCacheWriteString(writer, node->value.string)
+                       : AST_CACHE_NO_STRING;
+  } else if (node->type != AST_NODE_TYPE_FIELD_ACCESS) {
+    /* a field access caches a slot resolved at run time */
+    record.value = node->value.integer;
+  }
+
+  vectorPush(writer->nodes, record);
+
+  if (node->children) {
+    for (u32 i = 0; i < vectorLength(node->children); ++i) {
+      ASTCacheWriteNode(writer, &node->children[i]);
+    }
+  }
+}
+
+static b8 ASTCacheWriteBody(ASTCacheWriter *writer, ParserBody *body) {
+  ASTCacheBody record = {};
+  if (body->source != writer->source) {
+    u32 count = vectorLength(writer->imports);
+    record.source = count + 1;
+    for (u32 i = 0; body->path && i < count; ++i) {
+      if (!strcmp(body->path, writer->imports[i])) {
+        record.source = i + 1;
+        break;
+      }
+    }
+
+    if (record.source > count) {
+      return false;
+    }
+  }
+
+  Token *first = &body->tokens[body->begin];
+  Token *last = &body->tokens[body->end - 1];
+  record.offset = tokenOffset(first);
+  record.length = tokenOffset(last) + last->length - record.offset;
+  record.line = first->line;
+  record.yields = body->yields;
+  vectorPush(writer->bodies, record);
+
+  return true;
+}
+
+/* walks the tree as ASTCacheReadNode would, without building it */
+static b8 ASTCacheCheckNode(ASTCacheReader *reader) {
+  if (reader->cursor >= reader->node_count) {
+    return false;
+  }
+
+  ASTCacheNode *record = &reader->nodes[reader->cursor++];
+  if (record->type >= AST_NODE_TYPE_MAX) {
+    return false;
+  }
+
+  if (ASTCacheHasString(record->type) && record->value != AST_CACHE_NO_STRING &&
+      record->value >= reader->strings_size) {
+    return false;
+  }
+
+  if (record->type == AST_NODE_TYPE_LAZY_BLOCK) {
+    return record->child_count == AST_CACHE_NO_CHILDREN &&
+           record->value < reader->body_count;
+  }
+
+  if (record->child_count == AST_CACHE_NO_CHILDREN) {
+    return true;
+  }
+
+  for (u32 i = 0; i < record->child_count; ++i) {
+    if (!ASTCacheCheckNode(reader)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* every body has to lie within the file it points into */
+static b8 ASTCacheCheckBodies(ASTCacheReader *reader, FileView *imports,
+                              u64 length) {
+  for (u64 i = 0; i < reader->body_count; ++i) {
+    ASTCacheBody *body = &reader->bodies[i];
+    if (body->source > vectorLength(imports)) {
+      return false;
+    }
+
+    u64 size = body->source ? imports[body->source - 1].length : length;
+    if (body->length == 0 || body->length > size ||
+        body->offset > size - body->length) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static ASTNode ASTCacheReadNode(ASTCacheReader *reader) {
+  ASTCacheNode *record = &reader->nodes[reader->cursor++];
+
+  ASTNode node = {};
+  node.type = record->type;
+  node.line = record->line;
+
+  if (record->type == AST_NODE_TYPE_LAZY_BLOCK) {
+    ASTCacheBody *body = &reader->bodies[record->value];
+    node.value.body =
+        parserBodyCreate(reader->sources[body->source] + body->offset,
+                         body->length, body->line, body->yields);
+    vectorPush(*reader->out_bodies, node.value.body);
+  } else if (ASTCacheHasString(record->type)) {
+    node.value.string = record->value == AST_CACHE_NO_STRING
+                            ? 0
+                            : reader->strings + record->value;
+  } else {
+    node.value.integer = record->value;
+  }
+
+  if (record->child_count != AST_CACHE_NO_CHILDREN) {
+    u32 count = record->child_count;
+    node.children = vectorReserve(ASTNode, count ? count : 1);
+    for (u32 i = 0; i < count; ++i) {
+      vectorPush(node.children, ASTCacheReadNode(reader));
+    }
+  }
+
+  return node;
+}
+
+static b8 ASTCacheFileHash(const char *path, u64 *out_hash) {
+  FileView view;
+  if (!fileViewOpen(path, &view)) {
+    return false;
+  }
+
+  *out_hash = ASTCacheHash(view.data, view.length);
+  fileViewClose(&view);
+
+  return true;
+}
+
+static b8 ASTCacheWriteAll(i32 fd, const void *data, u64 size) {
+  const char *cursor = data;
+  while (size > 0) {
+    i64 count = write(fd, cursor, size);
+    if (count <= 0) {
+      return false;
+    }
+
+    cursor += count;
+    size -= count;
+  }
+
+  return true;
+}
\ No newline at end of file
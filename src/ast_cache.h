@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ast_node.h"
+#include "defines.h"
+#include "file_io.h"
+#include "parser.h"
+
+/* compiled form of a parsed file, stored next to it as <path>c or in
+ * LIV_CACHE_DIR. it is keyed by a hash of the source and of every file the
+ * source imports, and mapped back in place of lexing and parsing. the
+ * strings of a loaded tree point into the mapping. function bodies are
+ * stored as the span of their text and stay unparsed until called.
+ * LIV_CACHE=0 turns the cache off */
+
+/* a loaded cache file and what its tree refers to */
+typedef struct ASTCache {
+  void *mapping;
+  u64 size;
+  /* the imported files, the bodies point into them or into the source */
+  FileView *imports;
+  /* their canonical paths, into the mapping */
+  char **paths;
+  ParserBody **bodies;
+} ASTCache;
+
+/* false if the cache is turned off */
+b8 ASTCachePath(const char *source_path, char *out_path, u64 size);
+
+/* true if the cache matches source and its imports. the tree stays valid
+ * until the cache is released, the bodies also need source */
+b8 ASTCacheLoad(const char *cache_path, const char *source, u64 length,
+                ASTNode *out_root, ASTCache *out_cache);
+/* best effort, nothing is written if the cache file cannot be created */
+void ASTCacheStore(const char *cache_path, const char *source, u64 length,
+                   ASTNode *root, char **imports);
+void ASTCacheRelease(ASTCache *cache);
\ No newline at end of file
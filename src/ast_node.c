@@ -24,13 +24,17 @@ void ASTPrint(ASTNode *root) {
 
 void ASTNodePrint(ASTNode *node) {
   const char *types[AST_NODE_TYPE_MAX + 1] = {
-      "MULT",   "DIV",     "PLUS",      "MINUS",  "GT",        "LT",
-      "GE",     "LE",      "EQ",        "NE",     "AND",       "OR",
-      "ASSIGN", "POSTINC", "POSTDEC",   "IDENT",  "INTLIT",    "FLOATLIT",
-      "STRLIT", "CHARLIT", "STRUCTLIT", "ARRAY",  "FUNC_CALL", "ARR_ACCESS",
-      "NOT",    "VAR",     "IF",        "ELSE",   "WHILE",     "FOR",
-      "FUN",    "RETURN",  "CONTINUE",  "BREAK",  "PRINT",     "INT",
-      "CHAR",   "FLOAT",   "VOID",      "STRING", "PROGRAMM",  "BLOCK",
+      "MULT",      "DIV",       "PLUS",      "MINUS",      "GT",
+      "LT",        "GE",        "LE",        "EQ",         "NE",
+      "AND",       "OR",        "ASSIGN",    "POSTINC",    "POSTDEC",
+      "IDENT",     "INTLIT",    "FLOATLIT",  "STRLIT",     "CHARLIT",
+      "STRUCTLIT", "ARRAY",     "FUNC_CALL", "ARR_ACCESS", "FIELD_ACCESS",
+      "ARR_SLICE", "NOT",       "SPAWN",     "AWAIT",      "VAR",
+      "IF",        "ELSE",      "WHILE",     "FOR",        "PFOR",
+      "FOR_IN",    "FOR_RANGE", "YIELD",     "FUN",        "STRUCT",
+      "RETURN",    "CONTINUE",  "BREAK",     "PRINT",      "INT",
+      "CHAR",      "FLOAT",     "VOID",      "STRING",     "PROGRAMM",
+      "BLOCK",     "LAZY_BLOCK",
   };
 
   switch (node->type) {
@@ -52,8 +52,16 @@ typedef enum ASTNodeType {
   AST_NODE_TYPE_FUNC_CALL,
   /* aray access arr[0] */
   AST_NODE_TYPE_ARR_ACCESS,
+  /* field access p.x */
+  AST_NODE_TYPE_FIELD_ACCESS,
+  /* array slice arr[lo:hi] */
+  AST_NODE_TYPE_ARR_SLICE,
   /* ! */
   AST_NODE_TYPE_NOT,
+  /* spawn f(args) */
+  AST_NODE_TYPE_SPAWN,
+  /* await future */
+  AST_NODE_TYPE_AWAIT,
   /* var */
   AST_NODE_TYPE_VAR,
   /* if */
@@ -64,8 +72,18 @@ typedef enum ASTNodeType {
   AST_NODE_TYPE_WHILE,
   /* for */
   AST_NODE_TYPE_FOR,
+  /* parallel for */
+  AST_NODE_TYPE_PFOR,
+  /* for x in xs */
+  AST_NODE_TYPE_FOR_IN,
+  /* for i in lo..hi */
+  AST_NODE_TYPE_FOR_RANGE,
+  /* yield */
+  AST_NODE_TYPE_YIELD,
   /* fun */
   AST_NODE_TYPE_FUN,
+  /* struct */
+  AST_NODE_TYPE_STRUCT,
   /* return */
   AST_NODE_TYPE_RETURN,
   /* continue */
@@ -91,11 +109,15 @@ typedef enum ASTNodeType {
    * } // block of code;
    */
   AST_NODE_TYPE_BLOCK,
+  /* function body not parsed yet, value.body */
+  AST_NODE_TYPE_LAZY_BLOCK,
   AST_NODE_TYPE_MAX,
 } ASTNodeType;
 
 typedef struct ASTNode {
   u8 type;
+  /* source line, reported by errors */
+  u32 line;
   InterpreterValue value;
   struct ASTNode *children;
 } ASTNode;
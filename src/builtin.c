@@ -0,0 +1,924 @@
+#include "builtin.h"
+
+#include "error.h"
+#include "eval_array.h"
+#include "eval_chan.h"
+#include "eval_map.h"
+#include "eval_string.h"
+#include "simd.h"
+#include "sort.h"
+#include "vector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Builtin {
+  const char *name;
+  EvalNativeFun function;
+} Builtin;
+
+static EvalValue builtinLen(EvalValue *args, u32 argc);
+
+static EvalValue builtinFind(EvalValue *args, u32 argc);
+static EvalValue builtinContains(EvalValue *args, u32 argc);
+static EvalValue builtinCount(EvalValue *args, u32 argc);
+static EvalValue builtinSplit(EvalValue *args, u32 argc);
+static EvalValue builtinReplace(EvalValue *args, u32 argc);
+
+static EvalValue builtinMap(EvalValue *args, u32 argc);
+static EvalValue builtinGet(EvalValue *args, u32 argc);
+static EvalValue builtinSet(EvalValue *args, u32 argc);
+static EvalValue builtinHas(EvalValue *args, u32 argc);
+static EvalValue builtinRemove(EvalValue *args, u32 argc);
+static EvalValue builtinKeys(EvalValue *args, u32 argc);
+static EvalValue builtinValues(EvalValue *args, u32 argc);
+
+static EvalValue builtinSum(EvalValue *args, u32 argc);
+static EvalValue builtinMin(EvalValue *args, u32 argc);
+static EvalValue builtinMax(EvalValue *args, u32 argc);
+static EvalValue builtinDot(EvalValue *args, u32 argc);
+static EvalValue builtinFill(EvalValue *args, u32 argc);
+static EvalValue builtinCopy(EvalValue *args, u32 argc);
+static EvalValue builtinScale(EvalValue *args, u32 argc);
+static EvalValue builtinAxpy(EvalValue *args, u32 argc);
+static EvalValue builtinPrefixSum(EvalValue *args, u32 argc);
+static EvalValue builtinAdd(EvalValue *args, u32 argc);
+static EvalValue builtinMul(EvalValue *args, u32 argc);
+
+static EvalValue builtinSort(EvalValue *args, u32 argc);
+static EvalValue builtinSortDesc(EvalValue *args, u32 argc);
+static EvalValue builtinArgsort(EvalValue *args, u32 argc);
+
+static EvalValue builtinChan(EvalValue *args, u32 argc);
+static EvalValue builtinSend(EvalValue *args, u32 argc);
+static EvalValue builtinTrySend(EvalValue *args, u32 argc);
+static EvalValue builtinRecv(EvalValue *args, u32 argc);
+static EvalValue builtinTryRecv(EvalValue *args, u32 argc);
+static EvalValue builtinClose(EvalValue *args, u32 argc);
+
+static void builtinExpectArgc(const char *name, u32 argc, u32 expected);
+static void builtinExpectType(const char *name, EvalValue *arg, u8 type);
+static void builtinExpectNeedle(const char *name, EvalString *needle);
+static i64 builtinFindFrom(EvalString *string, u64 from, EvalString *needle);
+
+static EvalArray *builtinExpectNumeric(const char *name, EvalValue *arg);
+static void builtinExpectSameLength(const char *name, EvalArray *left,
+                                    EvalArray *right);
+static f64 builtinNumber(const char *name, EvalValue *arg);
+static f64 builtinElement(EvalArray *array, u64 index);
+static EvalValue builtinExtremum(const char *name, EvalValue *args, u32 argc,
+                                 b8 max);
+static EvalValue builtinElementwise(const char *name, EvalValue *args,
+                                    u32 argc, b8 multiply);
+static EvalValue builtinArrayLike(EvalArray *array, u8 element_type);
+static EvalArray *builtinExpectSortable(const char *name, EvalValue *arg);
+static EvalValue builtinSortArray(const char *name, EvalValue *args, u32 argc,
+                                  b8 descending);
+static i32 builtinCompareStrings(const void *left, const void *right);
+
+static const Builtin builtins[] = {
+    {"len", builtinLen},           {"find", builtinFind},
+    {"contains", builtinContains}, {"count", builtinCount},
+    {"split", builtinSplit},       {"replace", builtinReplace},
+    {"map", builtinMap},           {"get", builtinGet},
+    {"set", builtinSet},           {"has", builtinHas},
+    {"remove", builtinRemove},     {"keys", builtinKeys},
+    {"values", builtinValues},     {"sum", builtinSum},
+    {"min", builtinMin},           {"max", builtinMax},
+    {"dot", builtinDot},           {"fill", builtinFill},
+    {"copy", builtinCopy},         {"scale", builtinScale},
+    {"axpy", builtinAxpy},         {"prefix_sum", builtinPrefixSum},
+    {"add", builtinAdd},           {"mul", builtinMul},
+    {"sort", builtinSort},         {"sort_desc", builtinSortDesc},
+    {"argsort", builtinArgsort},   {"chan", builtinChan},
+    {"send", builtinSend},         {"try_send", builtinTrySend},
+    {"recv", builtinRecv},         {"try_recv", builtinTryRecv},
+    {"close", builtinClose},
+};
+
+b8 builtinSearch(const char *name, EvalValue *out_value) {
+  for (u32 i = 0; i < sizeof(builtins) / sizeof(builtins[0]); ++i) {
+    if (!strcmp(builtins[i].name, name)) {
+      EvalValue value = {};
+      value.type = EVAL_VALUE_TYPE_NATIVE;
+      value.value.native = builtins[i].function;
+      *out_value = value;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static EvalValue builtinLen(EvalValue *args, u32 argc) {
+  builtinExpectArgc("len", argc, 1);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_INT;
+
+  switch (args[0].type) {
+  case EVAL_VALUE_TYPE_ARRAY: {
+    result.value.integer = args[0].value.array.length;
+  } break;
+  case EVAL_VALUE_TYPE_STRING: {
+    result.value.integer = args[0].value.string.length;
+  } break;
+  case EVAL_VALUE_TYPE_MAP: {
+    result.value.integer = evalMapLength(args[0].value.map);
+  } break;
+  default: {
+    RAISE("liv: len argument has no length!");
+  } break;
+  };
+
+  return result;
+}
+
+static EvalValue builtinFind(EvalValue *args, u32 argc) {
+  builtinExpectArgc("find", argc, 2);
+  builtinExpectType("find", &args[0], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("find", &args[1], EVAL_VALUE_TYPE_STRING);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_INT;
+  result.value.integer =
+      builtinFindFrom(&args[0].value.string, 0, &args[1].value.string);
+
+  return result;
+}
+
+static EvalValue builtinContains(EvalValue *args, u32 argc) {
+  builtinExpectArgc("contains", argc, 2);
+  builtinExpectType("contains", &args[0], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("contains", &args[1], EVAL_VALUE_TYPE_STRING);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_CHAR;
+  result.value.character =
+      builtinFindFrom(&args[0].value.string, 0, &args[1].value.string) >= 0;
+
+  return result;
+}
+
+/* non-overlapping occurrences */
+static EvalValue builtinCount(EvalValue *args, u32 argc) {
+  builtinExpectArgc("count", argc, 2);
+  builtinExpectType("count", &args[0], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("count", &args[1], EVAL_VALUE_TYPE_STRING);
+
+  EvalString *string = &args[0].value.string;
+  EvalString *needle = &args[1].value.string;
+  builtinExpectNeedle("count", needle);
+
+  i64 count = 0;
+  i64 position = 0;
+  while ((position = builtinFindFrom(string, position, needle)) >= 0) {
+    position += needle->length;
+    count++;
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_INT;
+  result.value.integer = count;
+
+  return result;
+}
+
+/* the parts are windows into the source string, nothing is copied */
+static EvalValue builtinSplit(EvalValue *args, u32 argc) {
+  builtinExpectArgc("split", argc, 2);
+  builtinExpectType("split", &args[0], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("split", &args[1], EVAL_VALUE_TYPE_STRING);
+
+  EvalString *string = &args[0].value.string;
+  EvalString *separator = &args[1].value.string;
+  builtinExpectNeedle("split", separator);
+
+  u64 parts = 1;
+  i64 position = 0;
+  while ((position = builtinFindFrom(string, position, separator)) >= 0) {
+    position += separator->length;
+    parts++;
+  }
+
+  EvalArray array = evalArrayCreate(&parts, 1, EVAL_VALUE_TYPE_STRING);
+
+  i64 start = 0;
+  for (u64 i = 0; i < parts; ++i) {
+    i64 end = builtinFindFrom(string, start, separator);
+    if (end < 0) {
+      end = string->length;
+    }
+
+    EvalValue *part = &((EvalValue *)array.elements)[i];
+    part->value.string = evalStringSlice(string, start, end);
+    start = end + separator->length;
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = array;
+
+  return result;
+}
+
+static EvalValue builtinReplace(EvalValue *args, u32 argc) {
+  builtinExpectArgc("replace", argc, 3);
+  builtinExpectType("replace", &args[0], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("replace", &args[1], EVAL_VALUE_TYPE_STRING);
+  builtinExpectType("replace", &args[2], EVAL_VALUE_TYPE_STRING);
+
+  EvalString *string = &args[0].value.string;
+  EvalString *from = &args[1].value.string;
+  EvalString *to = &args[2].value.string;
+  builtinExpectNeedle("replace", from);
+
+  u64 count = 0;
+  i64 position = 0;
+  while ((position = builtinFindFrom(string, position, from)) >= 0) {
+    position += from->length;
+    count++;
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_STRING;
+  if (count == 0) {
+    result.value.string = *string;
+
+    return result;
+  }
+
+  /* size the result once and copy the runs between the matches */
+  u64 length = string->length - count * from->length + count * to->length;
+  char *out = evalStringAllocate(length, &result.value.string);
+  const char *data = evalStringData(string);
+
+  i64 start = 0;
+  while ((position = builtinFindFrom(string, start, from)) >= 0) {
+    memcpy(out, data + start, position - start);
+    out += position - start;
+    memcpy(out, evalStringData(to), to->length);
+    out += to->length;
+    start = position + from->length;
+  }
+  memcpy(out, data + start, string->length - start);
+
+  return result;
+}
+
+static EvalValue builtinMap(EvalValue *args, u32 argc) {
+  builtinExpectArgc("map", argc, 0);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_MAP;
+  result.value.map = evalMapCreate();
+
+  return result;
+}
+
+/* get(m, key) fails on a missing key, get(m, key, default) does not */
+static EvalValue builtinGet(EvalValue *args, u32 argc) {
+  if (argc != 3) {
+    builtinExpectArgc("get", argc, 2);
+  }
+  builtinExpectType("get", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  EvalValue value = {};
+  if (evalMapGet(args[0].value.map, &args[1], &value)) {
+    return value;
+  }
+  if (argc == 3) {
+    return args[2];
+  }
+
+  RAISE("liv: get key is not in the map!");
+}
+
+static EvalValue builtinSet(EvalValue *args, u32 argc) {
+  builtinExpectArgc("set", argc, 3);
+  builtinExpectType("set", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  evalMapSet(args[0].value.map, &args[1], &args[2]);
+
+  return args[2];
+}
+
+static EvalValue builtinHas(EvalValue *args, u32 argc) {
+  builtinExpectArgc("has", argc, 2);
+  builtinExpectType("has", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_CHAR;
+  EvalValue value = {};
+  result.value.character = evalMapGet(args[0].value.map, &args[1], &value);
+
+  return result;
+}
+
+static EvalValue builtinRemove(EvalValue *args, u32 argc) {
+  builtinExpectArgc("remove", argc, 2);
+  builtinExpectType("remove", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_CHAR;
+  result.value.character = evalMapRemove(args[0].value.map, &args[1]);
+
+  return result;
+}
+
+static EvalValue builtinKeys(EvalValue *args, u32 argc) {
+  builtinExpectArgc("keys", argc, 1);
+  builtinExpectType("keys", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  EvalMapEntry *entries = evalMapEntries(args[0].value.map);
+  u64 length = vectorLength(entries);
+  EvalArray array = evalArrayCreate(&length, 1, EVAL_VALUE_TYPE_UNKNOWN);
+
+  for (u64 i = 0; i < length; ++i) {
+    evalArrayStore(&array, i, &entries[i].key);
+  }
+  vectorDestroy(entries);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = array;
+
+  return result;
+}
+
+static EvalValue builtinValues(EvalValue *args, u32 argc) {
+  builtinExpectArgc("values", argc, 1);
+  builtinExpectType("values", &args[0], EVAL_VALUE_TYPE_MAP);
+
+  EvalMapEntry *entries = evalMapEntries(args[0].value.map);
+  u64 length = vectorLength(entries);
+  EvalArray array = evalArrayCreate(&length, 1, EVAL_VALUE_TYPE_UNKNOWN);
+
+  for (u64 i = 0; i < length; ++i) {
+    evalArrayStore(&array, i, &entries[i].value);
+  }
+  vectorDestroy(entries);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = array;
+
+  return result;
+}
+
+/* the numeric builtins work on whole views of int, float and char arrays.
+ * int and float arrays go through the simd kernels, mixed element types fall
+ * back to a float loop */
+static EvalValue builtinSum(EvalValue *args, u32 argc) {
+  builtinExpectArgc("sum", argc, 1);
+  EvalArray *array = builtinExpectNumeric("sum", &args[0]);
+  u64 n = evalArraySize(array);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_INT;
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_FLOAT: {
+    result.type = EVAL_VALUE_TYPE_FLOAT;
+    result.value.floating = simdSumF64(evalArrayData(array), n);
+  } break;
+  case EVAL_VALUE_TYPE_INT: {
+    result.value.integer = simdSumI64(evalArrayData(array), n);
+  } break;
+  default: {
+    char *data = evalArrayData(array);
+    for (u64 i = 0; i < n; ++i) {
+      result.value.integer += data[i];
+    }
+  } break;
+  };
+
+  return result;
+}
+
+static EvalValue builtinMin(EvalValue *args, u32 argc) {
+  return builtinExtremum("min", args, argc, false);
+}
+
+static EvalValue builtinMax(EvalValue *args, u32 argc) {
+  return builtinExtremum("max", args, argc, true);
+}
+
+static EvalValue builtinDot(EvalValue *args, u32 argc) {
+  builtinExpectArgc("dot", argc, 2);
+  EvalArray *left = builtinExpectNumeric("dot", &args[0]);
+  EvalArray *right = builtinExpectNumeric("dot", &args[1]);
+  builtinExpectSameLength("dot", left, right);
+  u64 n = evalArraySize(left);
+
+  EvalValue result = {};
+  if (left->element_type == EVAL_VALUE_TYPE_FLOAT &&
+      right->element_type == EVAL_VALUE_TYPE_FLOAT) {
+    result.type = EVAL_VALUE_TYPE_FLOAT;
+    result.value.floating =
+        simdDotF64(evalArrayData(left), evalArrayData(right), n);
+  } else if (left->element_type == EVAL_VALUE_TYPE_INT &&
+             right->element_type == EVAL_VALUE_TYPE_INT) {
+    i64 *x = evalArrayData(left);
+    i64 *y = evalArrayData(right);
+
+    result.type = EVAL_VALUE_TYPE_INT;
+    for (u64 i = 0; i < n; ++i) {
+      result.value.integer += x[i] * y[i];
+    }
+  } else {
+    result.type = EVAL_VALUE_TYPE_FLOAT;
+    for (u64 i = 0; i < n; ++i) {
+      result.value.floating +=
+          builtinElement(left, i) * builtinElement(right, i);
+    }
+  }
+
+  return result;
+}
+
+static EvalValue builtinFill(EvalValue *args, u32 argc) {
+  builtinExpectArgc("fill", argc, 2);
+  EvalArray *array = builtinExpectNumeric("fill", &args[0]);
+  u64 n = evalArraySize(array);
+
+  /* store once to get the value converted to the element type */
+  if (n > 0) {
+    evalArrayStore(array, array->offset, &args[1]);
+  }
+
+  if (array->element_type == EVAL_VALUE_TYPE_CHAR) {
+    char *data = evalArrayData(array);
+    memset(data, data[0], n);
+  } else if (n > 0) {
+    u64 bits;
+    memcpy(&bits, evalArrayData(array), sizeof(bits));
+    simdFill64(evalArrayData(array), bits, n);
+  }
+
+  return args[0];
+}
+
+/* copy(dst, src) copies the elements of src into dst */
+static EvalValue builtinCopy(EvalValue *args, u32 argc) {
+  builtinExpectArgc("copy", argc, 2);
+  builtinExpectType("copy", &args[0], EVAL_VALUE_TYPE_ARRAY);
+  builtinExpectType("copy", &args[1], EVAL_VALUE_TYPE_ARRAY);
+
+  EvalArray *dst = &args[0].value.array;
+  EvalArray *src = &args[1].value.array;
+  builtinExpectSameLength("copy", dst, src);
+  u64 n = evalArraySize(dst);
+
+  if (dst->element_type == src->element_type ||
+      (!evalArrayIsNumeric(dst) && !evalArrayIsNumeric(src))) {
+    memmove(evalArrayData(dst), evalArrayData(src),
+            n * evalArrayElementSize(dst->element_type));
+  } else {
+    for (u64 i = 0; i < n; ++i) {
+      EvalValue element = evalArrayLoad(src, src->offset + i);
+      evalArrayStore(dst, dst->offset + i, &element);
+    }
+  }
+
+  return args[0];
+}
+
+static EvalValue builtinScale(EvalValue *args, u32 argc) {
+  builtinExpectArgc("scale", argc, 2);
+  EvalArray *array = builtinExpectNumeric("scale", &args[0]);
+  f64 factor = builtinNumber("scale", &args[1]);
+  u64 n = evalArraySize(array);
+
+  if (array->element_type == EVAL_VALUE_TYPE_FLOAT) {
+    simdScaleF64(evalArrayData(array), factor, n);
+  } else if (array->element_type == EVAL_VALUE_TYPE_INT &&
+             args[1].type != EVAL_VALUE_TYPE_FLOAT) {
+    i64 *data = evalArrayData(array);
+    i64 integer = (i64)factor;
+    for (u64 i = 0; i < n; ++i) {
+      data[i] *= integer;
+    }
+  } else {
+    for (u64 i = 0; i < n; ++i) {
+      EvalValue element = {};
+      element.type = EVAL_VALUE_TYPE_FLOAT;
+      element.value.floating = builtinElement(array, i) * factor;
+      evalArrayStore(array, array->offset + i, &element);
+    }
+  }
+
+  return args[0];
+}
+
+/* axpy(a, x, y) computes y = a * x + y in place */
+static EvalValue builtinAxpy(EvalValue *args, u32 argc) {
+  builtinExpectArgc("axpy", argc, 3);
+  f64 factor = builtinNumber("axpy", &args[0]);
+  EvalArray *x = builtinExpectNumeric("axpy", &args[1]);
+  EvalArray *y = builtinExpectNumeric("axpy", &args[2]);
+  builtinExpectSameLength("axpy", x, y);
+  u64 n = evalArraySize(x);
+
+  if (x->element_type == EVAL_VALUE_TYPE_FLOAT &&
+      y->element_type == EVAL_VALUE_TYPE_FLOAT) {
+    simdAxpyF64(evalArrayData(y), factor, evalArrayData(x), n);
+  } else if (x->element_type == EVAL_VALUE_TYPE_INT &&
+             y->element_type == EVAL_VALUE_TYPE_INT &&
+             args[0].type != EVAL_VALUE_TYPE_FLOAT) {
+    i64 *from = evalArrayData(x);
+    i64 *to = evalArrayData(y);
+    i64 integer = (i64)factor;
+    for (u64 i = 0; i < n; ++i) {
+      to[i] += integer * from[i];
+    }
+  } else {
+    for (u64 i = 0; i < n; ++i) {
+      EvalValue element = {};
+      element.type = EVAL_VALUE_TYPE_FLOAT;
+      element.value.floating =
+          factor * builtinElement(x, i) + builtinElement(y, i);
+      evalArrayStore(y, y->offset + i, &element);
+    }
+  }
+
+  return args[2];
+}
+
+/* inclusive running sum as a new array, char arrays sum to ints */
+static EvalValue builtinPrefixSum(EvalValue *args, u32 argc) {
+  builtinExpectArgc("prefix_sum", argc, 1);
+  EvalArray *array = builtinExpectNumeric("prefix_sum", &args[0]);
+  u64 n = evalArraySize(array);
+
+  EvalValue result = builtinArrayLike(
+      array, array->element_type == EVAL_VALUE_TYPE_FLOAT
+                 ? EVAL_VALUE_TYPE_FLOAT
+                 : EVAL_VALUE_TYPE_INT);
+  void *out = evalArrayData(&result.value.array);
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_FLOAT: {
+    simdPrefixSumF64(out, evalArrayData(array), n);
+  } break;
+  case EVAL_VALUE_TYPE_INT: {
+    simdPrefixSumI64(out, evalArrayData(array), n);
+  } break;
+  default: {
+    char *data = evalArrayData(array);
+    i64 sum = 0;
+    for (u64 i = 0; i < n; ++i) {
+      sum += data[i];
+      ((i64 *)out)[i] = sum;
+    }
+  } break;
+  };
+
+  return result;
+}
+
+static EvalValue builtinAdd(EvalValue *args, u32 argc) {
+  return builtinElementwise("add", args, argc, false);
+}
+
+static EvalValue builtinMul(EvalValue *args, u32 argc) {
+  return builtinElementwise("mul", args, argc, true);
+}
+
+/* sorts work in place on the array storage and return the array */
+static EvalValue builtinSort(EvalValue *args, u32 argc) {
+  return builtinSortArray("sort", args, argc, false);
+}
+
+static EvalValue builtinSortDesc(EvalValue *args, u32 argc) {
+  return builtinSortArray("sort_desc", args, argc, true);
+}
+
+/* indices that would sort the array, equal elements keep their order */
+static EvalValue builtinArgsort(EvalValue *args, u32 argc) {
+  builtinExpectArgc("argsort", argc, 1);
+  EvalArray *array = builtinExpectSortable("argsort", &args[0]);
+  if (!evalArrayIsNumeric(array)) {
+    RAISE("liv: argsort expects an int, float or char array!");
+  }
+
+  u64 n = array->length;
+  EvalValue result = builtinArrayLike(array, EVAL_VALUE_TYPE_INT);
+  i64 *indices = evalArrayData(&result.value.array);
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_INT: {
+    argsortI64(evalArrayData(array), indices, n);
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    argsortF64(evalArrayData(array), indices, n);
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    argsortChar(evalArrayData(array), indices, n);
+  } break;
+  };
+
+  return result;
+}
+
+static EvalValue builtinChan(EvalValue *args, u32 argc) {
+  builtinExpectArgc("chan", argc, 1);
+
+  f64 capacity = builtinNumber("chan", &args[0]);
+  if (capacity < 1) {
+    RAISE("liv: chan capacity must be positive!");
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_CHAN;
+  result.value.chan = evalChanCreate((u64)capacity);
+
+  return result;
+}
+
+/* send(ch, v) waits while the channel is full */
+static EvalValue builtinSend(EvalValue *args, u32 argc) {
+  builtinExpectArgc("send", argc, 2);
+  builtinExpectType("send", &args[0], EVAL_VALUE_TYPE_CHAN);
+
+  evalChanSend(args[0].value.chan, &args[1]);
+
+  return args[1];
+}
+
+static EvalValue builtinTrySend(EvalValue *args, u32 argc) {
+  builtinExpectArgc("try_send", argc, 2);
+  builtinExpectType("try_send", &args[0], EVAL_VALUE_TYPE_CHAN);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_CHAR;
+  result.value.character = evalChanTrySend(args[0].value.chan, &args[1]);
+
+  return result;
+}
+
+/* recv(ch) waits for a value and fails once the channel is closed and
+ * drained, recv(ch, default) returns the default instead */
+static EvalValue builtinRecv(EvalValue *args, u32 argc) {
+  if (argc != 2) {
+    builtinExpectArgc("recv", argc, 1);
+  }
+  builtinExpectType("recv", &args[0], EVAL_VALUE_TYPE_CHAN);
+
+  EvalValue result = {};
+  if (evalChanRecv(args[0].value.chan, &result)) {
+    return result;
+  }
+  if (argc == 2) {
+    return args[1];
+  }
+
+  RAISE("liv: recv on a closed channel!");
+}
+
+/* try_recv(ch, default) returns the default when no value is ready */
+static EvalValue builtinTryRecv(EvalValue *args, u32 argc) {
+  builtinExpectArgc("try_recv", argc, 2);
+  builtinExpectType("try_recv", &args[0], EVAL_VALUE_TYPE_CHAN);
+
+  EvalValue result = {};
+  if (evalChanTryRecv(args[0].value.chan, &result)) {
+    return result;
+  }
+
+  return args[1];
+}
+
+static EvalValue builtinClose(EvalValue *args, u32 argc) {
+  builtinExpectArgc("close", argc, 1);
+  builtinExpectType("close", &args[0], EVAL_VALUE_TYPE_CHAN);
+
+  evalChanClose(args[0].value.chan);
+
+  return args[0];
+}
+
+static void builtinExpectArgc(const char *name, u32 argc, u32 expected) {
+  if (argc != expected) {
+    RAISE("liv: %s expects %u arguments, but %u were provided!", name,
+          expected, argc);
+  }
+}
+
+static void builtinExpectType(const char *name, EvalValue *arg, u8 type) {
+  if (arg->type != type) {
+    RAISE("liv: %s argument has a wrong type!", name);
+  }
+}
+
+static void builtinExpectNeedle(const char *name, EvalString *needle) {
+  if (needle->length == 0) {
+    RAISE("liv: %s argument must not be empty!", name);
+  }
+}
+
+static i64 builtinFindFrom(EvalString *string, u64 from, EvalString *needle) {
+  if (from > string->length) {
+    return -1;
+  }
+
+  i64 position = simdFind(evalStringData(string) + from, string->length - from,
+                          evalStringData(needle), needle->length);
+
+  return position < 0 ? -1 : (i64)from + position;
+}
+
+static EvalArray *builtinExpectNumeric(const char *name, EvalValue *arg) {
+  if (arg->type != EVAL_VALUE_TYPE_ARRAY ||
+      !evalArrayIsNumeric(&arg->value.array)) {
+    RAISE("liv: %s expects an int, float or char array!", name);
+  }
+
+  return &arg->value.array;
+}
+
+static void builtinExpectSameLength(const char *name, EvalArray *left,
+                                    EvalArray *right) {
+  if (evalArraySize(left) != evalArraySize(right)) {
+    RAISE("liv: %s arguments have different sizes!", name);
+  }
+}
+
+static f64 builtinNumber(const char *name, EvalValue *arg) {
+  switch (arg->type) {
+  case EVAL_VALUE_TYPE_INT: {
+    return arg->value.integer;
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    return arg->value.floating;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    return arg->value.character;
+  } break;
+  };
+
+  RAISE("liv: %s argument is not a number!", name);
+}
+
+/* element of a numeric view by its index in the view */
+static f64 builtinElement(EvalArray *array, u64 index) {
+  EvalValue element = evalArrayLoad(array, array->offset + index);
+
+  return builtinNumber("array", &element);
+}
+
+static EvalValue builtinExtremum(const char *name, EvalValue *args, u32 argc,
+                                 b8 max) {
+  builtinExpectArgc(name, argc, 1);
+  EvalArray *array = builtinExpectNumeric(name, &args[0]);
+  u64 n = evalArraySize(array);
+  if (n == 0) {
+    RAISE("liv: %s argument is empty!", name);
+  }
+
+  EvalValue result = {};
+  result.type = array->element_type;
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_FLOAT: {
+    f64 *data = evalArrayData(array);
+    result.value.floating = max ? simdMaxF64(data, n) : simdMinF64(data, n);
+  } break;
+  case EVAL_VALUE_TYPE_INT: {
+    i64 *data = evalArrayData(array);
+    result.value.integer = max ? simdMaxI64(data, n) : simdMinI64(data, n);
+  } break;
+  default: {
+    char *data = evalArrayData(array);
+    result.value.character = data[0];
+    for (u64 i = 1; i < n; ++i) {
+      if (max ? data[i] > result.value.character
+              : data[i] < result.value.character) {
+        result.value.character = data[i];
+      }
+    }
+  } break;
+  };
+
+  return result;
+}
+
+/* new array of the same shape, ints stay ints and anything else is float */
+static EvalValue builtinElementwise(const char *name, EvalValue *args,
+                                    u32 argc, b8 multiply) {
+  builtinExpectArgc(name, argc, 2);
+  EvalArray *left = builtinExpectNumeric(name, &args[0]);
+  EvalArray *right = builtinExpectNumeric(name, &args[1]);
+  builtinExpectSameLength(name, left, right);
+  u64 n = evalArraySize(left);
+
+  b8 integer = left->element_type == EVAL_VALUE_TYPE_INT &&
+               right->element_type == EVAL_VALUE_TYPE_INT;
+  b8 floating = left->element_type == EVAL_VALUE_TYPE_FLOAT &&
+                right->element_type == EVAL_VALUE_TYPE_FLOAT;
+
+  EvalValue result = builtinArrayLike(
+      left, integer ? EVAL_VALUE_TYPE_INT : EVAL_VALUE_TYPE_FLOAT);
+  void *out = evalArrayData(&result.value.array);
+  void *x = evalArrayData(left);
+  void *y = evalArrayData(right);
+
+  if (floating) {
+    if (multiply) {
+      simdMulF64(out, x, y, n);
+    } else {
+      simdAddF64(out, x, y, n);
+    }
+  } else if (integer && !multiply) {
+    simdAddI64(out, x, y, n);
+  } else if (integer) {
+    for (u64 i = 0; i < n; ++i) {
+      ((i64 *)out)[i] = ((i64 *)x)[i] * ((i64 *)y)[i];
+    }
+  } else {
+    for (u64 i = 0; i < n; ++i) {
+      f64 a = builtinElement(left, i);
+      f64 b = builtinElement(right, i);
+      ((f64 *)out)[i] = multiply ? a * b : a + b;
+    }
+  }
+
+  return result;
+}
+
+static EvalValue builtinArrayLike(EvalArray *array, u8 element_type) {
+  u64 extents[array->rank];
+  extents[0] = array->length;
+  for (u8 i = 1; i < array->rank; ++i) {
+    extents[i] = array->dims[i - 1];
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = evalArrayCreate(extents, array->rank, element_type);
+
+  return result;
+}
+
+static EvalArray *builtinExpectSortable(const char *name, EvalValue *arg) {
+  builtinExpectType(name, arg, EVAL_VALUE_TYPE_ARRAY);
+
+  EvalArray *array = &arg->value.array;
+  if (array->rank != 1) {
+    RAISE("liv: %s expects a one-dimensional array!", name);
+  }
+
+  return array;
+}
+
+/* numeric arrays use the radix and intro sorts, boxed arrays may hold
+ * strings only */
+static EvalValue builtinSortArray(const char *name, EvalValue *args, u32 argc,
+                                  b8 descending) {
+  builtinExpectArgc(name, argc, 1);
+  EvalArray *array = builtinExpectSortable(name, &args[0]);
+  u64 n = array->length;
+  void *data = evalArrayData(array);
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_INT: {
+    sortI64(data, n);
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    sortF64(data, n);
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    sortChar(data, n);
+  } break;
+  default: {
+    EvalValue *elements = data;
+    for (u64 i = 0; i < n; ++i) {
+      if (elements[i].type != EVAL_VALUE_TYPE_STRING) {
+        RAISE("liv: %s expects an array of numbers or strings!", name);
+      }
+    }
+
+    qsort(elements, n, sizeof(EvalValue), builtinCompareStrings);
+  } break;
+  };
+
+  if (descending) {
+    u64 size = evalArrayElementSize(array->element_type);
+    char swap[sizeof(EvalValue)];
+    char *bytes = data;
+
+    for (u64 i = 0, j = n; i + 1 < j; ++i, --j) {
+      memcpy(swap, bytes + i * size, size);
+      memcpy(bytes + i * size, bytes + (j - 1) * size, size);
+      memcpy(bytes + (j - 1) * size, swap, size);
+    }
+  }
+
+  return args[0];
+}
+
+static i32 builtinCompareStrings(const void *left, const void *right) {
+  return evalStringCompare(&((EvalValue *)left)->value.string,
+                           &((EvalValue *)right)->value.string);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+b8 builtinSearch(const char *name, EvalValue *out_value);
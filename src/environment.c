@@ -1,14 +1,23 @@
 #include "environment.h"
 
+#include "eval_array.h"
+#include "eval_map.h"
+#include "eval_string.h"
+#include "eval_struct.h"
 #include "vector.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+static void environmentFreezeValue(EvalValue *value, EvalMap **visited,
+                                   EvalMap ***maps);
+static b8 environmentVisit(EvalMap **visited, void *pointer, u64 length);
+
 void environmentCreate(Environment *parent, Environment *out_env) {
   out_env->variables = vectorCreate(EvalVariable);
   out_env->parent = parent;
+  out_env->frozen = 0;
 }
 
 void environmentDestroy(Environment *env) {
@@ -70,7 +79,163 @@ b8 environmentSet(Environment *env, const char *name, EvalValue value) {
     return false;
   }
 
+  if (__atomic_load_n(&env->frozen, __ATOMIC_RELAXED)) {
+    return false;
+  }
+
   var->value = value;
 
   return true;
-}
\ No newline at end of file
+}
+
+/* the captured names are indexed in a probe table, the inner binding is
+ * pushed first and shadows the later ones */
+void environmentCapture(Environment *env, Environment *out_env) {
+  u64 count = 0;
+  for (Environment *scope = env; scope; scope = scope->parent) {
+    count += vectorLength(scope->variables);
+  }
+
+  u64 capacity = 16;
+  while (capacity < count * 2) {
+    capacity *= 2;
+  }
+
+  u32 *slots = malloc(sizeof(u32) * capacity);
+  memset(slots, 0xff, sizeof(u32) * capacity);
+
+  out_env->variables = vectorReserve(EvalVariable, count);
+  out_env->parent = 0;
+  out_env->frozen = 1;
+
+  for (; env; env = env->parent) {
+    for (u32 i = 0; i < vectorLength(env->variables); ++i) {
+      EvalVariable *var = &env->variables[i];
+
+      u64 slot = evalStringHash(var->identifier, strlen(var->identifier));
+      for (slot &= capacity - 1; slots[slot] != UINT32_MAX;
+           slot = (slot + 1) & (capacity - 1)) {
+        if (!strcmp(out_env->variables[slots[slot]].identifier,
+                    var->identifier)) {
+          break;
+        }
+      }
+
+      if (slots[slot] == UINT32_MAX) {
+        slots[slot] = vectorLength(out_env->variables);
+        vectorPush(out_env->variables, *var);
+      }
+    }
+  }
+
+  free(slots);
+}
+
+EvalMap **environmentFreeze(Environment *env, char **names) {
+  EvalMap **maps = vectorCreate(EvalMap *);
+  EvalMap *visited = 0;
+
+  for (u32 i = 0; i < vectorLength(names); ++i) {
+    EvalValue value = {};
+    if (environmentSearch(env, names[i], &value)) {
+      environmentFreezeValue(&value, &visited, &maps);
+    }
+  }
+
+  for (; env; env = env->parent) {
+    __atomic_add_fetch(&env->frozen, 1, __ATOMIC_RELAXED);
+  }
+
+  if (visited) {
+    evalMapDestroy(visited);
+  }
+
+  return maps;
+}
+
+void environmentThaw(Environment *env, EvalMap **maps) {
+  for (; env; env = env->parent) {
+    __atomic_sub_fetch(&env->frozen, 1, __ATOMIC_RELAXED);
+  }
+
+  for (u32 i = 0; i < vectorLength(maps); ++i) {
+    __atomic_sub_fetch(&maps[i]->frozen, 1, __ATOMIC_RELAXED);
+  }
+
+  vectorDestroy(maps);
+}
+
+/* a map can also be reached through other maps, boxed arrays and structs.
+ * arrays themselves stay writable, their length is fixed */
+static void environmentFreezeValue(EvalValue *value, EvalMap **visited,
+                                   EvalMap ***maps) {
+  switch (value->type) {
+  case EVAL_VALUE_TYPE_MAP: {
+    EvalMap *map = value->value.map;
+    if (!map || !environmentVisit(visited, map, 0)) {
+      return;
+    }
+
+    __atomic_add_fetch(&map->frozen, 1, __ATOMIC_RELAXED);
+    vectorPush(*maps, map);
+
+    EvalMapEntry *entries = evalMapEntries(map);
+    for (u64 i = 0; i < vectorLength(entries); ++i) {
+      environmentFreezeValue(&entries[i].key, visited, maps);
+      environmentFreezeValue(&entries[i].value, visited, maps);
+    }
+    vectorDestroy(entries);
+  } break;
+  case EVAL_VALUE_TYPE_ARRAY: {
+    EvalArray *array = &value->value.array;
+    u64 size = evalArraySize(array);
+    if (!array->elements || evalArrayIsNumeric(array) ||
+        !environmentVisit(visited, evalArrayData(array), size)) {
+      return;
+    }
+
+    EvalValue *elements = evalArrayData(array);
+    for (u64 i = 0; i < size; ++i) {
+      environmentFreezeValue(&elements[i], visited, maps);
+    }
+  } break;
+  case EVAL_VALUE_TYPE_STRUCT: {
+    EvalStruct *structure = &value->value.structure;
+    if (!structure->slots || !environmentVisit(visited, structure->slots, 0)) {
+      return;
+    }
+
+    for (u32 i = 0; i < evalStructFieldCount(structure->type); ++i) {
+      environmentFreezeValue(&structure->slots[i], visited, maps);
+    }
+  } break;
+  default: {
+  } break;
+  };
+}
+
+/* false if the storage was already walked, slices of an array share it and
+ * are walked again only when they reach further. the set is created on the
+ * first container */
+static b8 environmentVisit(EvalMap **visited, void *pointer, u64 length) {
+  if (!*visited) {
+    *visited = evalMapCreate();
+  }
+
+  EvalValue key = {};
+  key.type = EVAL_VALUE_TYPE_INT;
+  key.value.integer = (i64)pointer;
+
+  EvalValue seen = {};
+  if (evalMapGet(*visited, &key, &seen) &&
+      (u64)seen.value.integer >= length) {
+    return false;
+  }
+
+  EvalValue reach = {};
+  reach.type = EVAL_VALUE_TYPE_INT;
+  reach.value.integer = length;
+  evalMapSet(*visited, &key, &reach);
+
+  return true;
+}
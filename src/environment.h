@@ -6,6 +6,9 @@
 typedef struct Environment {
   EvalVariable *variables;
   struct Environment *parent;
+  /* number of parallel loops running below this scope, its bindings cannot
+   * be reassigned while it is not zero */
+  u32 frozen;
 } Environment;
 
 void environmentCreate(Environment *parent, Environment *out_env);
@@ -13,4 +16,15 @@ void environmentDestroy(Environment *env);
 
 b8 environmentSearch(Environment *env, const char *name, EvalValue *out_value);
 b8 environmentEmplace(Environment *env, char *name, EvalValue value);
-b8 environmentSet(Environment *env, const char *name, EvalValue value);
\ No newline at end of file
+/* false if the symbol is unbound or its scope is frozen */
+b8 environmentSet(Environment *env, const char *name, EvalValue value);
+
+/* flattens the bindings visible from env into a new frozen scope, inner
+ * bindings shadow the outer ones */
+void environmentCapture(Environment *env, Environment *out_env);
+
+/* freezes or thaws env and every scope above it. freezing also freezes the
+ * maps reachable from the bindings of names and returns them, they are
+ * thawed with the scopes */
+EvalMap **environmentFreeze(Environment *env, char **names);
+void environmentThaw(Environment *env, EvalMap **maps);
\ No newline at end of file
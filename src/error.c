@@ -0,0 +1,54 @@
+#include "error.h"
+
+#include "logger.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static _Thread_local ErrorTrap *error_trap = 0;
+static _Thread_local u64 error_line = 0;
+
+void errorTrapPush(ErrorTrap *trap) {
+  trap->error.message[0] = 0;
+  trap->error.line = 0;
+  trap->previous = error_trap;
+  error_trap = trap;
+}
+
+void errorTrapPop(ErrorTrap *trap) { error_trap = trap->previous; }
+
+void errorLocate(u64 line) { error_line = line; }
+
+void errorLog(const Error *error) {
+  if (error->line) {
+    FATAL("%s (line %lu)", error->message, error->line);
+  } else {
+    FATAL("%s", error->message);
+  }
+}
+
+void errorRaise(u64 line, const char *message, ...) {
+  Error error;
+  error.line = line ? line : error_line;
+
+  va_list arg_ptr;
+  va_start(arg_ptr, message);
+  vsnprintf(error.message, ERROR_MESSAGE_LENGTH, message, arg_ptr);
+  va_end(arg_ptr);
+
+  errorRethrow(&error);
+}
+
+void errorRethrow(Error *error) {
+  ErrorTrap *trap = error_trap;
+  if (!trap) {
+    errorLog(error);
+    exit(1);
+  }
+
+  trap->error = *error;
+  error_trap = trap->previous;
+
+  longjmp(trap->jump, 1);
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "defines.h"
+
+#include <setjmp.h>
+
+#define ERROR_MESSAGE_LENGTH 512
+
+/* a script error. line is 0 when the failing code has no known position */
+typedef struct Error {
+  char message[ERROR_MESSAGE_LENGTH];
+  u64 line;
+} Error;
+
+/* recovery point for errors raised on the current thread. traps nest, a
+ * raise pops the innermost one and jumps back into its setjmp:
+ *
+ *   ErrorTrap trap;
+ *   errorTrapPush(&trap);
+ *   if (setjmp(trap.jump) == 0) {
+ *     ...
+ *     errorTrapPop(&trap);
+ *   } else {
+ *     ... trap.error holds the error
+ *   }
+ */
+typedef struct ErrorTrap {
+  jmp_buf jump;
+  Error error;
+  struct ErrorTrap *previous;
+} ErrorTrap;
+
+void errorTrapPush(ErrorTrap *trap);
+void errorTrapPop(ErrorTrap *trap);
+
+/* line of the statement being run on the current thread, reported by
+ * errors raised without one */
+void errorLocate(u64 line);
+
+void errorLog(const Error *error);
+
+/* unwinds to the innermost trap. without a trap the error is logged and the
+ * process exits */
+_Noreturn void errorRaise(u64 line, const char *message, ...);
+_Noreturn void errorRethrow(Error *error);
+
+#define RAISE(message, ...) errorRaise(0, message, ##__VA_ARGS__);
+#define RAISE_AT(line, message, ...) errorRaise(line, message, ##__VA_ARGS__);
\ No newline at end of file
@@ -1,11 +1,21 @@
 #include "eval.h"
 
+#include "builtin.h"
 #include "defines.h"
+#include "error.h"
+#include "eval_array.h"
+#include "eval_generator.h"
+#include "eval_map.h"
+#include "eval_string.h"
+#include "eval_struct.h"
 #include "logger.h"
+#include "parser.h"
+#include "thread_pool.h"
 #include "vector.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static EvalValue evalProgram(ASTNode *node, Environment *env);
 static EvalValue evalBlock(ASTNode *node, Environment *env);
@@ -40,16 +50,36 @@ static EvalValue evalStructlit(ASTNode *node, Environment *env);
 
 static EvalValue evalArray(ASTNode *node, Environment *env);
 static EvalValue evalArrAccess(ASTNode *node, Environment *env);
+static EvalValue evalArrSlice(ASTNode *node, Environment *env);
+static EvalValue evalFieldAccess(ASTNode *node, Environment *env);
 
 static EvalValue evalIf(ASTNode *node, Environment *env);
 static EvalValue evalElse(ASTNode *node, Environment *env);
 
 static EvalValue evalWhile(ASTNode *node, Environment *env);
 static EvalValue evalFor(ASTNode *node, Environment *env);
+static EvalValue evalPfor(ASTNode *node, Environment *env);
+static EvalValue evalForIn(ASTNode *node, Environment *env);
+static EvalValue evalForRange(ASTNode *node, Environment *env);
+static void evalPforChunk(void *data);
+static void evalPforNames(ASTNode *node, Environment *env, char ***names);
 
 static EvalValue evalVar(ASTNode *node, Environment *env);
 static EvalValue evalFun(ASTNode *node, Environment *env);
 static EvalValue evalFuncCall(ASTNode *node, Environment *env);
+static EvalValue evalFunApply(const char *fn_name, EvalFunData *data,
+                              EvalValue *args, u32 argc, Environment *parent);
+static void evalFunBind(const char *fn_name, EvalFunData *data,
+                        EvalValue *args, u32 argc, Environment *env);
+static ASTNode *evalFunBody(EvalFunData *data);
+static EvalValue evalGeneratorCall(const char *fn_name, EvalFunData *data,
+                                   EvalValue *args, u32 argc,
+                                   Environment *parent);
+static EvalValue evalSpawn(ASTNode *node, Environment *env);
+static void evalSpawnTask(void *data);
+static EvalValue evalAwait(ASTNode *node, Environment *env);
+static EvalValue evalNativeCall(ASTNode *node, EvalNativeFun native,
+                                Environment *env);
 static EvalValue evalInt(ASTNode *node, Environment *env);
 static EvalValue evalFloat(ASTNode *node, Environment *env);
 static EvalValue evalChar(ASTNode *node, Environment *env);
@@ -62,9 +92,27 @@ static EvalValue evalContinue(ASTNode *node, Environment *env);
 static EvalValue evalBreak(ASTNode *node, Environment *env);
 
 static EvalValue evalPrint(ASTNode *node, Environment *env);
+static void evalPrintValue(EvalValue *value);
+
+static void evalIndices(ASTNode *node, u32 first, u32 count, i64 *indices,
+                        Environment *env);
+static void evalSetVariable(Environment *env, char *name, EvalValue value);
+static EvalValue evalConcat(EvalValue *left, EvalValue *right);
+static i32 evalCompareStrings(EvalValue *left, EvalValue *right,
+                              const char *op);
+static EvalString evalToString(EvalValue *value);
+static EvalValue evalStructLiteral(EvalStructType *type, ASTNode *node,
+                                   Environment *env);
+static u64 evalFieldSlot(ASTNode *node, EvalStruct *structure);
+static void evalFieldStore(EvalStruct *structure, u64 slot, EvalValue *value);
+static void evalArrayFill(ASTNode *init, EvalArray *array, u32 depth,
+                          u64 *position, Environment *env);
 
 /* astnodetype to EvalValueType */
 static u8 evalAnttoevt(u8 type);
+/* type annotation to EvalValueType, including named types */
+static u8 evalTypeOf(ASTNode *type_node, Environment *env);
+static EvalStructType *evalStructTypeOf(ASTNode *type_node, Environment *env);
 static f64 evalRetrieveNumber(EvalValue *value);
 static void evalSetNumberByType(EvalValue *eval_value, f64 value);
 static u8 evalDominantType(u8 left, u8 right);
@@ -121,6 +169,12 @@ EvalValue eval(ASTNode *node, Environment *env) {
   case AST_NODE_TYPE_NOT: {
     return evalNot(node, env);
   } break;
+  case AST_NODE_TYPE_SPAWN: {
+    return evalSpawn(node, env);
+  } break;
+  case AST_NODE_TYPE_AWAIT: {
+    return evalAwait(node, env);
+  } break;
 
   case AST_NODE_TYPE_ASSIGN: {
     return evalAssign(node, env);
@@ -158,6 +212,12 @@ EvalValue eval(ASTNode *node, Environment *env) {
   case AST_NODE_TYPE_ARR_ACCESS: {
     return evalArrAccess(node, env);
   } break;
+  case AST_NODE_TYPE_ARR_SLICE: {
+    return evalArrSlice(node, env);
+  } break;
+  case AST_NODE_TYPE_FIELD_ACCESS: {
+    return evalFieldAccess(node, env);
+  } break;
 
   case AST_NODE_TYPE_VAR: {
     return evalVar(node, env);
@@ -183,6 +243,9 @@ EvalValue eval(ASTNode *node, Environment *env) {
   case AST_NODE_TYPE_STRING: {
     return evalString(node, env);
   } break;
+  case AST_NODE_TYPE_STRUCT: {
+    return evalStruct(node, env);
+  } break;
 
   case AST_NODE_TYPE_IF: {
     return evalIf(node, env);
@@ -197,6 +260,18 @@ EvalValue eval(ASTNode *node, Environment *env) {
   case AST_NODE_TYPE_FOR: {
     return evalFor(node, env);
   } break;
+  case AST_NODE_TYPE_PFOR: {
+    return evalPfor(node, env);
+  } break;
+  case AST_NODE_TYPE_FOR_IN: {
+    return evalForIn(node, env);
+  } break;
+  case AST_NODE_TYPE_FOR_RANGE: {
+    return evalForRange(node, env);
+  } break;
+  case AST_NODE_TYPE_YIELD: {
+    RAISE("liv: yield outside of a generator!");
+  } break;
 
   case AST_NODE_TYPE_RETURN: {
     return evalReturn(node, env);
@@ -213,8 +288,7 @@ EvalValue eval(ASTNode *node, Environment *env) {
   } break;
   };
 
-  FATAL("liv: unknown node type\n");
-  exit(1);
+  RAISE("liv: unknown node type\n");
 
   EvalValue result = {};
   result.type = EVAL_VALUE_TYPE_UNKNOWN;
@@ -223,9 +297,13 @@ EvalValue eval(ASTNode *node, Environment *env) {
 
 static EvalValue evalProgram(ASTNode *node, Environment *env) {
   for (u32 i = 0; i < vectorLength(node->children); ++i) {
+    errorLocate(node->children[i].line);
     eval(&node->children[i], env);
   }
 
+  /* spawned tasks nobody awaited still run on the program's tree */
+  threadPoolJoin();
+
   EvalValue result = {};
   result.type = EVAL_VALUE_TYPE_UNKNOWN;
   return result;
@@ -241,6 +319,7 @@ static EvalValue evalBlock(ASTNode *node, Environment *env) {
   for (int i = 0; i < vectorLength(node->children); ++i) {
     ASTNode *element = &node->children[i];
 
+    errorLocate(element->line);
     result = eval(element, &local_env);
 
     if (result.payload != EVAL_PAYLOAD_TYPE_NONE) {
@@ -255,20 +334,25 @@ static EvalValue evalBlock(ASTNode *node, Environment *env) {
   return result;
 }
 
-/* TODO: add string concatenation support */
 static EvalValue evalPlus(ASTNode *node, Environment *env) {
   ASTNode *lhs = &node->children[0];
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    return evalConcat(&left, &right);
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: + argument is not a number!");
-    exit(1);
+    RAISE("liv: + argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
+  if (right.type == EVAL_VALUE_TYPE_STRING) {
+    return evalConcat(&left, &right);
+  }
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: + argument is not a number!");
-    exit(1);
+    RAISE("liv: + argument is not a number!");
   }
 
   f64 left_value = evalRetrieveNumber(&left);
@@ -290,13 +374,11 @@ static EvalValue evalMinus(ASTNode *node, Environment *env) {
 
   EvalValue left = eval(lhs, env);
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: - argument is not a number!");
-    exit(1);
+    RAISE("liv: - argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: - argument is not a number!");
-    exit(1);
+    RAISE("liv: - argument is not a number!");
   }
 
   f64 left_value = evalRetrieveNumber(&left);
@@ -318,13 +400,11 @@ static EvalValue evalMult(ASTNode *node, Environment *env) {
 
   EvalValue left = eval(lhs, env);
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: * argument is not a number!");
-    exit(1);
+    RAISE("liv: * argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: * argument is not a number!");
-    exit(1);
+    RAISE("liv: * argument is not a number!");
   }
 
   f64 left_value = evalRetrieveNumber(&left);
@@ -346,13 +426,11 @@ static EvalValue evalDiv(ASTNode *node, Environment *env) {
 
   EvalValue left = eval(lhs, env);
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: / argument is not a number!");
-    exit(1);
+    RAISE("liv: / argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: / argument is not a number!");
-    exit(1);
+    RAISE("liv: / argument is not a number!");
   }
 
   f64 left_value = evalRetrieveNumber(&left);
@@ -373,14 +451,21 @@ static EvalValue evalGt(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, ">") > 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: > argument is not a number!");
-    exit(1);
+    RAISE("liv: > argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: > argument is not a number!");
-    exit(1);
+    RAISE("liv: > argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -398,14 +483,21 @@ static EvalValue evalLt(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, "<") < 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: < argument is not a number!");
-    exit(1);
+    RAISE("liv: < argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: < argument is not a number!");
-    exit(1);
+    RAISE("liv: < argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -423,14 +515,21 @@ static EvalValue evalGe(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, ">=") >= 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: >= argument is not a number!");
-    exit(1);
+    RAISE("liv: >= argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: >= argument is not a number!");
-    exit(1);
+    RAISE("liv: >= argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -448,14 +547,21 @@ static EvalValue evalLe(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, "<=") <= 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: <= argument is not a number!");
-    exit(1);
+    RAISE("liv: <= argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: <= argument is not a number!");
-    exit(1);
+    RAISE("liv: <= argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -473,14 +579,21 @@ static EvalValue evalEq(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, "==") == 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: == argument is not a number!");
-    exit(1);
+    RAISE("liv: == argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: == argument is not a number!");
-    exit(1);
+    RAISE("liv: == argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -498,14 +611,21 @@ static EvalValue evalNe(ASTNode *node, Environment *env) {
   ASTNode *rhs = &node->children[1];
 
   EvalValue left = eval(lhs, env);
+  if (left.type == EVAL_VALUE_TYPE_STRING) {
+    EvalValue right = eval(rhs, env);
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalCompareStrings(&left, &right, "!=") != 0;
+
+    return result;
+  }
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: != argument is not a number!");
-    exit(1);
+    RAISE("liv: != argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: != argument is not a number!");
-    exit(1);
+    RAISE("liv: != argument is not a number!");
   }
 
   f64 left_val = evalRetrieveNumber(&left);
@@ -524,13 +644,11 @@ static EvalValue evalAnd(ASTNode *node, Environment *env) {
 
   EvalValue left = eval(lhs, env);
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: && argument is not a number!");
-    exit(1);
+    RAISE("liv: && argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: && argument is not a number!");
-    exit(1);
+    RAISE("liv: && argument is not a number!");
   }
 
   i32 left_result = (i32)evalRetrieveNumber(&left);
@@ -553,13 +671,11 @@ static EvalValue evalOr(ASTNode *node, Environment *env) {
 
   EvalValue left = eval(lhs, env);
   if (!evalIsNumber(left.type)) {
-    FATAL("liv: || argument is not a number!");
-    exit(1);
+    RAISE("liv: || argument is not a number!");
   }
   EvalValue right = eval(rhs, env);
   if (!evalIsNumber(right.type)) {
-    FATAL("liv: || argument is not a number!");
-    exit(1);
+    RAISE("liv: || argument is not a number!");
   }
 
   i32 left_result = (i32)evalRetrieveNumber(&left);
@@ -581,8 +697,7 @@ static EvalValue evalNot(ASTNode *node, Environment *env) {
 
   EvalValue value = eval(exp, env);
   if (!evalIsNumber(value.type)) {
-    FATAL("liv: ! argument is not a number!");
-    exit(1);
+    RAISE("liv: ! argument is not a number!");
   }
 
   i32 val = (i32)evalRetrieveNumber(&value);
@@ -609,37 +724,56 @@ static EvalValue evalAssign(ASTNode *node, Environment *env) {
 
     EvalValue value = {};
     if (!environmentSearch(env, name, &value)) {
-      FATAL("liv: unbound symbol %s", name);
-      exit(1);
+      RAISE("liv: unbound symbol %s", name);
     }
 
     result = eval(right, env);
-    environmentSet(env, name, result);
+    evalSetVariable(env, name, result);
   } else if (left->type == AST_NODE_TYPE_ARR_ACCESS) {
     ASTNode *ident_node = &left->children[0];
-    ASTNode *index_node = &left->children[1];
-
-    EvalValue size_value = eval(index_node, env);
-    if (!evalIsNumber(size_value.type)) {
-      FATAL("liv: = argument is not a number!");
-      exit(1);
-    }
-
     char *name = ident_node->value.identifier;
-    i32 index = (i32)evalRetrieveNumber(&size_value);
+    u32 count = vectorLength(left->children) - 1;
 
     EvalValue value = {};
     if (!environmentSearch(env, name, &value)) {
-      FATAL("liv: unbound symbol %s", name);
-      exit(1);
+      RAISE("liv: unbound symbol %s", name);
     }
 
-    EvalValue *vec = value.value.array;
+    if (value.type == EVAL_VALUE_TYPE_MAP && count == 1) {
+      EvalValue key = eval(&left->children[1], env);
+
+      result = eval(right, env);
+      evalMapSet(value.value.map, &key, &result);
+
+      return result;
+    }
+
+    if (value.type != EVAL_VALUE_TYPE_ARRAY) {
+      RAISE("liv: %s is not an array!", name);
+    }
+
+    i64 indices[count];
+    evalIndices(left, 1, count, indices, env);
+
+    EvalArray *array = &value.value.array;
+    if (count != array->rank) {
+      RAISE("liv: cannot assign to a row of %s!", name);
+    }
 
     result = eval(right, env);
-    vec[index] = result;
+    evalArrayStore(array, evalArrayOffset(array, indices, count), &result);
+  } else if (left->type == AST_NODE_TYPE_FIELD_ACCESS) {
+    EvalValue object = eval(&left->children[0], env);
+    if (object.type != EVAL_VALUE_TYPE_STRUCT) {
+      RAISE("liv: . argument is not a struct!");
+    }
+
+    EvalStruct *structure = &object.value.structure;
+    u64 slot = evalFieldSlot(left, structure);
 
-    environmentSet(env, name, value);
+    result = eval(right, env);
+    evalFieldStore(structure, slot, &result);
+    result = structure->slots[slot];
   }
 
   return result;
@@ -650,13 +784,11 @@ static EvalValue evalPostinc(ASTNode *node, Environment *env) {
 
   EvalValue value = {};
   if (!environmentSearch(env, name, &value)) {
-    FATAL("liv: unbound symbol %s", name);
-    exit(1);
+    RAISE("liv: unbound symbol %s", name);
   }
 
   if (!evalIsNumber(value.type)) {
-    FATAL("liv: ++ argument is not a number!");
-    exit(1);
+    RAISE("liv: ++ argument is not a number!");
   }
 
   f64 val = evalRetrieveNumber(&value);
@@ -665,7 +797,7 @@ static EvalValue evalPostinc(ASTNode *node, Environment *env) {
   result.type = value.type;
   evalSetNumberByType(&result, val + 1);
 
-  environmentSet(env, name, result);
+  evalSetVariable(env, name, result);
 
   return result;
 }
@@ -675,13 +807,11 @@ static EvalValue evalPostdec(ASTNode *node, Environment *env) {
 
   EvalValue value = {};
   if (!environmentSearch(env, name, &value)) {
-    FATAL("liv: unbound symbol %s", name);
-    exit(1);
+    RAISE("liv: unbound symbol %s", name);
   }
 
   if (!evalIsNumber(value.type)) {
-    FATAL("liv: -- argument is not a number!");
-    exit(1);
+    RAISE("liv: -- argument is not a number!");
   }
 
   f64 val = evalRetrieveNumber(&value);
@@ -690,7 +820,7 @@ static EvalValue evalPostdec(ASTNode *node, Environment *env) {
   result.type = value.type;
   evalSetNumberByType(&result, val - 1);
 
-  environmentSet(env, name, result);
+  evalSetVariable(env, name, result);
 
   return result;
 }
@@ -700,8 +830,7 @@ static EvalValue evalIdent(ASTNode *node, Environment *env) {
 
   EvalValue result = {};
   if (!environmentSearch(env, ident, &result)) {
-    FATAL("liv: unbound symbol %s", ident);
-    exit(1);
+    RAISE("liv: unbound symbol %s", ident);
   }
 
   return result;
@@ -732,16 +861,19 @@ static EvalValue evalCharlit(ASTNode *node, Environment *env) {
 }
 
 static EvalValue evalStrlit(ASTNode *node, Environment *env) {
+  char *string = node->value.string;
+
   EvalValue result = {};
   result.type = EVAL_VALUE_TYPE_STRING;
-  /* TODO: should we copy the string value to the new memory block? */
-  result.value.string = node->value.string;
+  result.value.string = evalStringIntern(string, strlen(string));
 
   return result;
 }
 
-/* TODO: add struct support */
 static EvalValue evalStructlit(ASTNode *node, Environment *env) {
+  /* {..} is only valid where the declared type gives it a layout */
+  RAISE("liv: struct literal needs a declared struct type!");
+
   EvalValue result = {};
   result.type = EVAL_VALUE_TYPE_UNKNOWN;
 
@@ -757,32 +889,121 @@ static EvalValue evalArray(ASTNode *node, Environment *env) {
 
 static EvalValue evalArrAccess(ASTNode *node, Environment *env) {
   ASTNode *ident_node = &node->children[0];
-  ASTNode *index_node = &node->children[1];
 
   char *name = ident_node->value.identifier;
+  u32 count = vectorLength(node->children) - 1;
+
+  EvalValue value = {};
+  if (!environmentSearch(env, name, &value)) {
+    RAISE("liv: unbound symbol %s", name);
+  }
+
+  if (value.type == EVAL_VALUE_TYPE_MAP && count == 1) {
+    EvalValue key = eval(&node->children[1], env);
+
+    EvalValue element = {};
+    if (!evalMapGet(value.value.map, &key, &element)) {
+      RAISE("liv: key is not in the map %s!", name);
+    }
+
+    return element;
+  }
 
-  EvalValue index_value = eval(index_node, env);
-  if (!evalIsNumber(index_value.type)) {
-    FATAL("liv: [] argument is not a number!");
-    exit(1);
+  i64 indices[count];
+  evalIndices(node, 1, count, indices, env);
+
+  if (value.type == EVAL_VALUE_TYPE_STRING && count == 1) {
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_CHAR;
+    result.value.character = evalStringAt(&value.value.string, indices[0]);
+
+    return result;
   }
 
-  int index = evalRetrieveNumber(&index_value);
+  if (value.type != EVAL_VALUE_TYPE_ARRAY) {
+    RAISE("liv: %s is not an array!", name);
+  }
+
+  return evalArrayGet(&value.value.array, indices, count);
+}
+
+static EvalValue evalArrSlice(ASTNode *node, Environment *env) {
+  u32 length = vectorLength(node->children);
+  ASTNode *ident_node = &node->children[0];
+  ASTNode *lo_node = &node->children[length - 2];
+  ASTNode *hi_node = &node->children[length - 1];
+
+  char *name = ident_node->value.identifier;
 
   EvalValue value = {};
   if (!environmentSearch(env, name, &value)) {
-    FATAL("liv: unbound symbol %s", name);
-    exit(1);
+    RAISE("liv: unbound symbol %s", name);
   }
 
-  return value.value.array[index];
+  if (value.type != EVAL_VALUE_TYPE_ARRAY &&
+      (value.type != EVAL_VALUE_TYPE_STRING || length != 3)) {
+    RAISE("liv: %s is not an array!", name);
+  }
+
+  /* m[i][lo:hi] slices the row selected by the leading indices */
+  u32 count = length - 3;
+  if (count > 0) {
+    i64 indices[count];
+    evalIndices(node, 1, count, indices, env);
+
+    value = evalArrayGet(&value.value.array, indices, count);
+    if (value.type != EVAL_VALUE_TYPE_ARRAY) {
+      RAISE("liv: cannot slice an element of %s!", name);
+    }
+  }
+
+  /* missing bounds default to the whole array */
+  i64 lo = 0;
+  i64 hi = value.type == EVAL_VALUE_TYPE_STRING ? value.value.string.length
+                                                : value.value.array.length;
+  if (lo_node->type != AST_NODE_TYPE_VOID) {
+    EvalValue lo_value = eval(lo_node, env);
+    if (!evalIsNumber(lo_value.type)) {
+      RAISE("liv: [:] argument is not a number!");
+    }
+
+    lo = (i64)evalRetrieveNumber(&lo_value);
+  }
+  if (hi_node->type != AST_NODE_TYPE_VOID) {
+    EvalValue hi_value = eval(hi_node, env);
+    if (!evalIsNumber(hi_value.type)) {
+      RAISE("liv: [:] argument is not a number!");
+    }
+
+    hi = (i64)evalRetrieveNumber(&hi_value);
+  }
+
+  EvalValue result = {};
+  result.type = value.type;
+  if (value.type == EVAL_VALUE_TYPE_STRING) {
+    result.value.string = evalStringSlice(&value.value.string, lo, hi);
+  } else {
+    result.value.array = evalArraySlice(&value.value.array, lo, hi);
+  }
+
+  return result;
+}
+
+static EvalValue evalFieldAccess(ASTNode *node, Environment *env) {
+  EvalValue object = eval(&node->children[0], env);
+  if (object.type != EVAL_VALUE_TYPE_STRUCT) {
+    RAISE("liv: . argument is not a struct!");
+  }
+
+  EvalStruct *structure = &object.value.structure;
+
+  return structure->slots[evalFieldSlot(node, structure)];
 }
 
 static EvalValue evalIf(ASTNode *node, Environment *env) {
   EvalValue cond = eval(&node->children[0], env);
   if (!evalIsNumber(cond.type)) {
-    FATAL("liv: if argument is not a number!");
-    exit(1);
+    RAISE("liv: if argument is not a number!");
   }
 
   u8 result = cond.value.character;
@@ -831,8 +1052,7 @@ static EvalValue evalWhile(ASTNode *node, Environment *env) {
   for (;;) {
     EvalValue cond_value = eval(cond, env);
     if (!evalIsNumber(cond_value.type)) {
-      FATAL("liv: while argument is not a number!");
-      exit(1);
+      RAISE("liv: while argument is not a number!");
     }
 
     u8 val = cond_value.value.character;
@@ -880,8 +1100,7 @@ static EvalValue evalFor(ASTNode *node, Environment *env) {
   for (;;) {
     EvalValue cond_value = eval(cond, &local_env);
     if (!evalIsNumber(cond_value.type)) {
-      FATAL("liv: for argument is not a number!");
-      exit(1);
+      RAISE("liv: for argument is not a number!");
     }
 
     u8 val = cond_value.value.character;
@@ -919,6 +1138,256 @@ static EvalValue evalFor(ASTNode *node, Environment *env) {
   return result;
 }
 
+/* for x in xs { .. } binds each item of an array, generator or channel to x */
+static EvalValue evalForIn(ASTNode *node, Environment *env) {
+  char *name = node->children[0].value.identifier;
+  ASTNode *block = &node->children[2];
+
+  EvalValue source = eval(&node->children[1], env);
+  EvalIterator iterator = {};
+  evalIteratorCreate(&source, &iterator);
+
+  Environment local_env = {};
+  environmentCreate(env, &local_env);
+
+  EvalValue item = {};
+  environmentEmplace(&local_env, name, item);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+
+  while (evalIteratorNext(&iterator, &item)) {
+    local_env.variables[0].value = item;
+
+    EvalValue body = eval(block, &local_env);
+    if (body.payload == EVAL_PAYLOAD_TYPE_RETURN) {
+      result = body;
+      break;
+    }
+    if (body.payload == EVAL_PAYLOAD_TYPE_BREAK) {
+      break;
+    }
+  }
+
+  environmentDestroy(&local_env);
+
+  return result;
+}
+
+/* for i in lo..hi { .. } counts from lo up to hi, exclusive. the bounds are
+ * evaluated once and the counter is kept native, only its copy in the loop
+ * scope is visible to the body */
+static EvalValue evalForRange(ASTNode *node, Environment *env) {
+  char *name = node->children[0].value.identifier;
+  ASTNode *block = &node->children[3];
+
+  EvalValue lo_value = eval(&node->children[1], env);
+  EvalValue hi_value = eval(&node->children[2], env);
+  if (!evalIsNumber(lo_value.type) || !evalIsNumber(hi_value.type)) {
+    RAISE("liv: range bounds are not numbers!");
+  }
+
+  i64 lo = evalRetrieveNumber(&lo_value);
+  i64 hi = evalRetrieveNumber(&hi_value);
+
+  Environment local_env = {};
+  environmentCreate(env, &local_env);
+
+  EvalValue index = {};
+  index.type = EVAL_VALUE_TYPE_INT;
+  environmentEmplace(&local_env, name, index);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+
+  for (i64 i = lo; i < hi; ++i) {
+    /* the body may have reassigned the copy */
+    local_env.variables[0].value = index;
+    local_env.variables[0].value.value.integer = i;
+
+    EvalValue body = eval(block, &local_env);
+    if (body.payload == EVAL_PAYLOAD_TYPE_RETURN) {
+      result = body;
+      break;
+    }
+    if (body.payload == EVAL_PAYLOAD_TYPE_BREAK) {
+      break;
+    }
+  }
+
+  environmentDestroy(&local_env);
+
+  return result;
+}
+
+/* a range of pfor iterations, run by one task */
+typedef struct EvalPforChunk {
+  ASTNode *block;
+  Environment *env;
+  char *name;
+  i64 lo;
+  i64 hi;
+} EvalPforChunk;
+
+/* pfor (var i = lo; i < hi; i++) { .. }
+ *
+ * the iterations are split into chunks which run on the thread pool. every
+ * scope visible before the loop is frozen until it ends: its variables,
+ * and every map reachable from the ones the body names, can be read but not
+ * changed. the index
+ * and the variables declared in the body are private to an iteration.
+ * elements of outer arrays and fields of outer structs can be written, as
+ * long as each iteration writes its own */
+static EvalValue evalPfor(ASTNode *node, Environment *env) {
+  ASTNode *declare = &node->children[0];
+  ASTNode *cond = &node->children[1];
+  ASTNode *post = &node->children[2];
+  ASTNode *block = &node->children[3];
+
+  /* only the counted form can be split up front */
+  b8 counted = declare->type == AST_NODE_TYPE_VAR &&
+               vectorLength(declare->children) == 1 &&
+               declare->children[0].type == AST_NODE_TYPE_ASSIGN;
+  char *name = 0;
+  if (counted) {
+    name = declare->children[0].children[0].value.identifier;
+    counted = (cond->type == AST_NODE_TYPE_LT ||
+               cond->type == AST_NODE_TYPE_LE) &&
+              cond->children[0].type == AST_NODE_TYPE_IDENT &&
+              !strcmp(cond->children[0].value.identifier, name) &&
+              post->type == AST_NODE_TYPE_POSTINC &&
+              !strcmp(post->value.identifier, name);
+  }
+  if (!counted) {
+    RAISE("liv: pfor expects the form (var i = lo; i < hi; i++)!");
+  }
+
+  EvalValue lo_value = eval(&declare->children[0].children[1], env);
+  EvalValue hi_value = eval(&cond->children[1], env);
+  if (!evalIsNumber(lo_value.type) || !evalIsNumber(hi_value.type)) {
+    RAISE("liv: pfor bounds are not numbers!");
+  }
+
+  i64 lo = evalRetrieveNumber(&lo_value);
+  i64 hi = evalRetrieveNumber(&hi_value);
+  if (cond->type == AST_NODE_TYPE_LE) {
+    hi++;
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+
+  if (hi <= lo) {
+    return result;
+  }
+
+  /* several chunks per thread, so the stealing evens out uneven bodies */
+  u64 count = hi - lo;
+  u64 size = count / ((threadPoolSize() + 1) * 8);
+  if (size == 0) {
+    size = 1;
+  }
+  u64 chunk_count = (count + size - 1) / size;
+
+  EvalPforChunk *chunks = malloc(sizeof(EvalPforChunk) * chunk_count);
+  ThreadGroup group;
+  threadGroupCreate(&group);
+
+  char **names = vectorCreate(char *);
+  evalPforNames(block, env, &names);
+  EvalMap **frozen = environmentFreeze(env, names);
+  vectorDestroy(names);
+
+  for (u64 i = 0; i < chunk_count; ++i) {
+    EvalPforChunk *chunk = &chunks[i];
+    chunk->block = block;
+    chunk->env = env;
+    chunk->name = name;
+    chunk->lo = lo + i * size;
+    chunk->hi = chunk->lo + size < hi ? chunk->lo + size : hi;
+
+    threadPoolSubmit(&group, evalPforChunk, chunk);
+  }
+  threadPoolWait(&group);
+  environmentThaw(env, frozen);
+  free(chunks);
+
+  /* an iteration failed, the loop raises its error once every chunk is done */
+  if (group.error) {
+    Error error = *group.error;
+    threadGroupDestroy(&group);
+    errorRethrow(&error);
+  }
+
+  threadGroupDestroy(&group);
+
+  return result;
+}
+
+static void evalPforChunk(void *data) {
+  EvalPforChunk *chunk = data;
+
+  /* the index lives in its own frozen scope, the body's block opens a fresh
+   * scope per iteration */
+  Environment local_env = {};
+  environmentCreate(chunk->env, &local_env);
+
+  EvalValue index = {};
+  index.type = EVAL_VALUE_TYPE_INT;
+  environmentEmplace(&local_env, chunk->name, index);
+  local_env.frozen = 1;
+
+  for (i64 i = chunk->lo; i < chunk->hi; ++i) {
+    local_env.variables[0].value.value.integer = i;
+
+    EvalValue result = eval(chunk->block, &local_env);
+    if (result.payload == EVAL_PAYLOAD_TYPE_RETURN ||
+        result.payload == EVAL_PAYLOAD_TYPE_BREAK) {
+      RAISE("liv: cannot return or break out of a pfor!");
+    }
+  }
+
+  environmentDestroy(&local_env);
+}
+
+/* collects the names the body can read: its identifiers and, since a call
+ * runs in the caller's scope, those of the functions bound to them. a name
+ * that turns out to be a field or a local only freezes more than needed */
+static void evalPforNames(ASTNode *node, Environment *env, char ***names) {
+  if (node->type == AST_NODE_TYPE_LAZY_BLOCK) {
+    node = parserBodyBlock(node->value.body);
+  }
+
+  if (node->type == AST_NODE_TYPE_IDENT ||
+      node->type == AST_NODE_TYPE_POSTINC ||
+      node->type == AST_NODE_TYPE_POSTDEC) {
+    char *name = node->value.identifier;
+
+    b8 seen = false;
+    for (u32 i = 0; i < vectorLength(*names) && !seen; ++i) {
+      seen = !strcmp((*names)[i], name);
+    }
+
+    if (!seen) {
+      vectorPush(*names, name);
+
+      EvalValue value = {};
+      if (environmentSearch(env, name, &value) &&
+          value.type == EVAL_VALUE_TYPE_FUN) {
+        evalPforNames(evalFunBody(&value.value.function), env, names);
+      }
+    }
+  }
+
+  if (!node->children) {
+    return;
+  }
+
+  for (u32 i = 0; i < vectorLength(node->children); ++i) {
+    evalPforNames(&node->children[i], env, names);
+  }
+}
+
 static EvalValue evalVar(ASTNode *node, Environment *env) {
   /* store the last evaluated value */
   EvalValue fin = {};
@@ -934,20 +1403,27 @@ static EvalValue evalVar(ASTNode *node, Environment *env) {
 
       char *var_name = lhs->value.identifier;
 
-      result = eval(rhs, env);
-
       /* type is specified */
       if (vectorLength(lhs->children) == 1) {
         ASTNode *type_node = &lhs->children[0];
-        if (result.type != evalAnttoevt(type_node->type)) {
-          FATAL("liv: var argument does not match the specified type!");
-          exit(1);
+        EvalStructType *struct_type = evalStructTypeOf(type_node, env);
+
+        if (struct_type && rhs->type == AST_NODE_TYPE_STRUCTLIT) {
+          result = evalStructLiteral(struct_type, rhs, env);
+        } else {
+          result = eval(rhs, env);
+        }
+
+        if (result.type != evalTypeOf(type_node, env) ||
+            (struct_type && result.value.structure.type != struct_type)) {
+          RAISE("liv: var argument does not match the specified type!");
         }
+      } else {
+        result = eval(rhs, env);
       }
 
       if (!environmentEmplace(env, var_name, result)) {
-        FATAL("liv: symbol %s already bound", var_name);
-        exit(1);
+        RAISE("liv: symbol %s already bound", var_name);
       }
     } else if (child->type ==
                AST_NODE_TYPE_IDENT) { /* variable with a specified type, with
@@ -955,60 +1431,66 @@ static EvalValue evalVar(ASTNode *node, Environment *env) {
       ASTNode *type = &child->children[0];
 
       char *var_name = child->value.identifier;
-      result.type = evalAnttoevt(type->type);
+      result.type = evalTypeOf(type, env);
+      if (result.type == EVAL_VALUE_TYPE_MAP) {
+        result.value.map = evalMapCreate();
+      } else if (result.type == EVAL_VALUE_TYPE_STRUCT) {
+        result.value.structure =
+            evalStructCreate(evalStructTypeOf(type, env));
+      }
 
       if (!environmentEmplace(env, var_name, result)) {
-        FATAL("liv: symbol %s already bound", var_name);
-        exit(1);
+        RAISE("liv: symbol %s already bound", var_name);
       }
     } else if (child->type == AST_NODE_TYPE_ARRAY) {
-      ASTNode *num_node = &child->children[0];
-      ASTNode *ident_node = &child->children[1];
+      /* extents first, then the identifier and the optional initializer */
+      u8 rank = child->value.integer;
+      ASTNode *ident_node = &child->children[rank];
       ASTNode *type_node = &ident_node->children[0];
       char *var_name = ident_node->value.identifier;
 
-      EvalValue len_value = eval(num_node, env);
-      if (!evalIsNumber(len_value.type)) {
-        FATAL("liv: var argument is not a number!");
-        exit(1);
-      }
-
-      i32 num_elements = (i32)evalRetrieveNumber(&len_value);
+      u64 extents[rank];
+      for (u8 i = 0; i < rank; ++i) {
+        EvalValue len_value = eval(&child->children[i], env);
+        if (!evalIsNumber(len_value.type)) {
+          RAISE("liv: var argument is not a number!");
+        }
 
-      /* reserve elements */
-      EvalValue *vec = vectorReserve(EvalValue, num_elements);
+        i64 extent = (i64)evalRetrieveNumber(&len_value);
+        if (extent < 0) {
+          RAISE("liv: array %s has a negative size!", var_name);
+        }
 
-      for (u32 i = 0; i < num_elements; ++i) {
-        EvalValue element;
-        element.type = evalAnttoevt(type_node->type);
-        vectorPush(vec, element);
+        extents[i] = extent;
       }
 
-      /* array with initialization */
-      if (vectorLength(child->children) == 3) {
-        ASTNode *init = &child->children[2];
-        if (vectorLength(init->children) != num_elements) {
-          FATAL("liv: specified array size does not match to number of "
-                "elements!");
-          exit(1);
-        }
+      u8 element_type = evalTypeOf(type_node, env);
+      EvalArray array = evalArrayCreate(extents, rank, element_type);
 
-        /* TODO: check if sizes are correct */
-        for (u32 i = 0; i < vectorLength(init->children); ++i) {
-          ASTNode *lit = &init->children[i];
-          /* TODO: check that type is match (or can be converted) */
-          EvalValue val = eval(lit, env);
+      /* struct elements share one contiguous block of slots */
+      if (element_type == EVAL_VALUE_TYPE_STRUCT) {
+        evalStructCreateMany(evalStructTypeOf(type_node, env),
+                             (EvalValue *)array.elements,
+                             evalArraySize(&array));
+      }
+
+      /* array with initialization, rows may be nested or flattened */
+      if (vectorLength(child->children) == rank + 2) {
+        ASTNode *init = &child->children[rank + 1];
 
-          vec[i] = val;
+        u64 position = 0;
+        evalArrayFill(init, &array, 0, &position, env);
+        if (position != evalArraySize(&array)) {
+          RAISE("liv: specified array size does not match to number of "
+                "elements!");
         }
       }
 
       result.type = EVAL_VALUE_TYPE_ARRAY;
-      result.value.array = vec;
+      result.value.array = array;
 
       if (!environmentEmplace(env, var_name, result)) {
-        FATAL("liv: symbol %s already bound", var_name);
-        exit(1);
+        RAISE("liv: symbol %s already bound", var_name);
       }
     }
 
@@ -1031,7 +1513,7 @@ static EvalValue evalFun(ASTNode *node, Environment *env) {
     ASTNode *type_node = &arg_node->children[0];
 
     char *arg_name = arg_node->value.identifier;
-    u8 type = evalAnttoevt(type_node->type);
+    u8 type = evalTypeOf(type_node, env);
 
     EvalValue argument_value = {};
     argument_value.type = type;
@@ -1046,7 +1528,8 @@ static EvalValue evalFun(ASTNode *node, Environment *env) {
   ASTNode *block = &node->children[vectorLength(node->children) - 1];
   ASTNode *return_value = &node->children[vectorLength(node->children) - 2];
 
-  data.return_value = evalAnttoevt(return_value->type);
+  data.return_value = evalTypeOf(return_value, env);
+  data.generator = evalGeneratorYields(block);
   data.block = *block;
 
   EvalValue fun = {};
@@ -1059,64 +1542,263 @@ static EvalValue evalFun(ASTNode *node, Environment *env) {
 }
 
 static EvalValue evalFuncCall(ASTNode *node, Environment *env) {
-  Environment function_env = {};
-  environmentCreate(env, &function_env);
-
   ASTNode *name_node = &node->children[0];
   char *fn_name = name_node->value.identifier;
 
+  /* script definitions shadow the builtins */
   EvalValue function = {};
-  if (!environmentSearch(env, fn_name, &function)) {
-    FATAL("liv: unbound symbol %s", fn_name);
-    exit(1);
+  if (!environmentSearch(env, fn_name, &function) &&
+      !builtinSearch(fn_name, &function)) {
+    RAISE("liv: unbound symbol %s", fn_name);
+  }
+
+  if (function.type == EVAL_VALUE_TYPE_NATIVE) {
+    return evalNativeCall(node, function.value.native, env);
+  }
+
+  /* Point(x, y) fills the fields in order, Point() gives the defaults */
+  if (function.type == EVAL_VALUE_TYPE_STRUCT_TYPE) {
+    EvalStructType *type = function.value.struct_type;
+    u32 argc = vectorLength(node->children) - 1;
+    if (argc != 0 && argc != evalStructFieldCount(type)) {
+      RAISE("liv: number of provided arguments to struct %s does not match "
+            "the number of fields!",
+            fn_name);
+    }
+
+    EvalValue result = {};
+    result.type = EVAL_VALUE_TYPE_STRUCT;
+    result.value.structure = evalStructCreate(type);
+    for (u32 i = 0; i < argc; ++i) {
+      EvalValue field = eval(&node->children[i + 1], env);
+      evalFieldStore(&result.value.structure, i, &field);
+    }
+
+    return result;
   }
 
   if (function.type != EVAL_VALUE_TYPE_FUN) {
-    FATAL("liv: %s is not callable!", fn_name);
-    exit(1);
+    RAISE("liv: %s is not callable!", fn_name);
+  }
+
+  u32 argc = vectorLength(node->children) - 1;
+  EvalValue args[argc + 1];
+
+  for (u32 i = 0; i < argc; ++i) {
+    args[i] = eval(&node->children[i + 1], env);
+  }
+
+  return evalFunApply(fn_name, &function.value.function, args, argc, env);
+}
+
+EvalValue evalApply(const char *fn_name, EvalValue *function, EvalValue *args,
+                    u32 argc, Environment *env) {
+  if (function->type == EVAL_VALUE_TYPE_NATIVE) {
+    EvalValue result = function->value.native(args, argc);
+    result.payload = EVAL_PAYLOAD_TYPE_NONE;
+
+    return result;
+  }
+
+  if (function->type != EVAL_VALUE_TYPE_FUN) {
+    RAISE("liv: %s is not callable!", fn_name);
+  }
+
+  return evalFunApply(fn_name, &function->value.function, args, argc, env);
+}
+
+/* runs a script function on evaluated arguments, its scope is opened under
+ * parent */
+static EvalValue evalFunApply(const char *fn_name, EvalFunData *data,
+                              EvalValue *args, u32 argc, Environment *parent) {
+  if (data->generator) {
+    return evalGeneratorCall(fn_name, data, args, argc, parent);
   }
 
-  EvalFunData *data = &function.value.function;
+  Environment function_env = {};
+  environmentCreate(parent, &function_env);
+
   u8 return_value_type = data->return_value;
-  ASTNode *block = &data->block;
+  ASTNode *block = evalFunBody(data);
+
+  evalFunBind(fn_name, data, args, argc, &function_env);
+
+  EvalValue eval_result = eval(block, &function_env);
+  if (eval_result.type != return_value_type) {
+    /* TODO: check if got type can be converted to the expected type */
+  }
+
+  /* the return stops at the call, it must not unwind the caller's block */
+  eval_result.payload = EVAL_PAYLOAD_TYPE_NONE;
+
+  environmentDestroy(&function_env);
+
+  return eval_result;
+}
+
+static void evalFunBind(const char *fn_name, EvalFunData *data,
+                        EvalValue *args, u32 argc, Environment *env) {
   EvalVariable *arguments = data->arguments;
 
-  int argc = vectorLength(node->children) - 1;
   if (argc != vectorLength(arguments)) {
-    FATAL("liv: number of provided argument to function %s does not match the "
+    RAISE("liv: number of provided argument to function %s does not match the "
           "required number of arguments!",
           fn_name);
-    exit(1);
   }
 
-  for (int i = 1; i < vectorLength(node->children); ++i) {
-    ASTNode *arg_node = &node->children[i];
-
-    EvalValue eval_arg = eval(arg_node, env);
-
-    EvalVariable *argument = &data->arguments[i - 1];
+  for (u32 i = 0; i < argc; ++i) {
+    EvalVariable *argument = &arguments[i];
 
-    u8 got = eval_arg.type;
+    u8 got = args[i].type;
     u8 expected = argument->value.type;
 
     if (got != expected) {
       /* TODO: check if got type can be converted to the expected type */
     }
 
-    if (!environmentEmplace(&function_env, argument->identifier, eval_arg)) {
-      FATAL("liv: symbol %s already bound", arg_node->value.identifier);
-      exit(1);
+    if (!environmentEmplace(env, argument->identifier, args[i])) {
+      RAISE("liv: symbol %s already bound", argument->identifier);
     }
   }
+}
 
-  EvalValue eval_result = eval(block, &function_env);
-  if (eval_result.type != return_value_type) {
-    /* TODO: check if got type can be converted to the expected type */
+/* a body the parser stepped over is parsed on the first call */
+static ASTNode *evalFunBody(EvalFunData *data) {
+  if (data->block.type != AST_NODE_TYPE_LAZY_BLOCK) {
+    return &data->block;
   }
 
-  environmentDestroy(&function_env);
+  return parserBodyBlock(data->block.value.body);
+}
 
-  return eval_result;
+/* the body does not run until the generator is iterated. by then the
+ * caller's scopes may be gone, so it sees its arguments and the globals */
+static EvalValue evalGeneratorCall(const char *fn_name, EvalFunData *data,
+                                   EvalValue *args, u32 argc,
+                                   Environment *parent) {
+  ASTNode *block = evalFunBody(data);
+  while (parent->parent) {
+    parent = parent->parent;
+  }
+
+  Environment *scope = malloc(sizeof(Environment));
+  environmentCreate(parent, scope);
+  evalFunBind(fn_name, data, args, argc, scope);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_GENERATOR;
+  result.value.generator = evalGeneratorCreate(block, scope);
+
+  return result;
+}
+
+/* a spawned call, owned by its task until the result is written */
+typedef struct EvalSpawnCall {
+  EvalFuture *future;
+  char *name;
+  EvalValue function;
+  EvalValue *args;
+  u32 argc;
+  Environment scope;
+} EvalSpawnCall;
+
+/* spawn f(args)
+ *
+ * the arguments are evaluated here, then the call runs on the thread pool.
+ * it sees a frozen snapshot of the scopes visible at the spawn, so neither
+ * side can rebind a variable under the other. arrays, maps and structs
+ * remain shared by reference */
+static EvalValue evalSpawn(ASTNode *node, Environment *env) {
+  ASTNode *call = &node->children[0];
+  char *fn_name = call->children[0].value.identifier;
+
+  EvalValue function = {};
+  if (!environmentSearch(env, fn_name, &function) &&
+      !builtinSearch(fn_name, &function)) {
+    RAISE("liv: unbound symbol %s", fn_name);
+  }
+
+  if (function.type != EVAL_VALUE_TYPE_FUN &&
+      function.type != EVAL_VALUE_TYPE_NATIVE) {
+    RAISE("liv: cannot spawn %s, it is not a function!", fn_name);
+  }
+
+  EvalSpawnCall *spawn = malloc(sizeof(EvalSpawnCall));
+  spawn->future = malloc(sizeof(EvalFuture));
+  spawn->name = fn_name;
+  spawn->function = function;
+  spawn->argc = vectorLength(call->children) - 1;
+  spawn->args = malloc(sizeof(EvalValue) * (spawn->argc + 1));
+
+  for (u32 i = 0; i < spawn->argc; ++i) {
+    spawn->args[i] = eval(&call->children[i + 1], env);
+  }
+
+  environmentCapture(env, &spawn->scope);
+
+  EvalFuture *future = spawn->future;
+  threadGroupCreate(&future->group);
+  threadPoolSubmit(&future->group, evalSpawnTask, spawn);
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_FUTURE;
+  result.value.future = future;
+
+  return result;
+}
+
+static void evalSpawnTask(void *data) {
+  EvalSpawnCall *spawn = data;
+
+  EvalValue result = {};
+  if (spawn->function.type == EVAL_VALUE_TYPE_NATIVE) {
+    result = spawn->function.value.native(spawn->args, spawn->argc);
+  } else {
+    result = evalFunApply(spawn->name, &spawn->function.value.function,
+                          spawn->args, spawn->argc, &spawn->scope);
+  }
+  result.payload = EVAL_PAYLOAD_TYPE_NONE;
+
+  /* published by the group join in threadPoolWait */
+  spawn->future->result = result;
+
+  environmentDestroy(&spawn->scope);
+  free(spawn->args);
+  free(spawn);
+}
+
+/* await future, the waiting thread runs other tasks meanwhile. a future can
+ * be awaited any number of times */
+static EvalValue evalAwait(ASTNode *node, Environment *env) {
+  EvalValue value = eval(&node->children[0], env);
+  if (value.type != EVAL_VALUE_TYPE_FUTURE) {
+    RAISE("liv: await argument is not a future!");
+  }
+
+  EvalFuture *future = value.value.future;
+  threadPoolWait(&future->group);
+
+  /* the spawned call failed, every await raises its error */
+  if (future->group.error) {
+    errorRethrow(future->group.error);
+  }
+
+  return future->result;
+}
+
+static EvalValue evalNativeCall(ASTNode *node, EvalNativeFun native,
+                                Environment *env) {
+  u32 argc = vectorLength(node->children) - 1;
+  EvalValue args[argc + 1];
+
+  for (u32 i = 0; i < argc; ++i) {
+    args[i] = eval(&node->children[i + 1], env);
+  }
+
+  EvalValue result = native(args, argc);
+  result.payload = EVAL_PAYLOAD_TYPE_NONE;
+
+  return result;
 }
 
 /* TODO: add conversion support */
@@ -1149,8 +1831,42 @@ static EvalValue evalString(ASTNode *node, Environment *env) {
 }
 
 static EvalValue evalStruct(ASTNode *node, Environment *env) {
+  ASTNode *name_node = &node->children[0];
+  char *struct_name = name_node->value.identifier;
+
+  EvalStructType *type = evalStructTypeCreate(struct_name);
+  for (u32 i = 1; i < vectorLength(node->children); ++i) {
+    ASTNode *child = &node->children[i];
+    if (child->type != AST_NODE_TYPE_VAR) {
+      RAISE("liv: struct %s can only declare fields!", struct_name);
+    }
+
+    for (u32 j = 0; j < vectorLength(child->children); ++j) {
+      ASTNode *field_node = &child->children[j];
+      if (field_node->type != AST_NODE_TYPE_IDENT) {
+        RAISE("liv: field of struct %s must be declared with a type only!",
+              struct_name);
+      }
+
+      ASTNode *type_node = &field_node->children[0];
+      u8 field_type = evalTypeOf(type_node, env);
+      if (field_type == EVAL_VALUE_TYPE_UNKNOWN) {
+        RAISE("liv: unknown type of field %s in struct %s!",
+              field_node->value.identifier, struct_name);
+      }
+
+      evalStructTypeAddField(type, field_node->value.identifier, field_type,
+                             evalStructTypeOf(type_node, env));
+    }
+  }
+
   EvalValue result = {};
-  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+  result.type = EVAL_VALUE_TYPE_STRUCT_TYPE;
+  result.value.struct_type = type;
+
+  if (!environmentEmplace(env, struct_name, result)) {
+    RAISE("liv: symbol %s already bound", struct_name);
+  }
 
   return result;
 }
@@ -1194,30 +1910,254 @@ static EvalValue evalPrint(ASTNode *node, Environment *env) {
 
   EvalValue val = eval(child, env);
 
-  switch (val.type) {
+  evalPrintValue(&val);
+  printf("\n");
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+
+  return result;
+}
+
+static void evalPrintValue(EvalValue *value) {
+  switch (value->type) {
   case EVAL_VALUE_TYPE_INT: {
-    printf("%ld\n", val.value.integer);
+    printf("%ld", value->value.integer);
   } break;
   case EVAL_VALUE_TYPE_FLOAT: {
-    printf("%f\n", val.value.floating);
+    printf("%f", value->value.floating);
   } break;
   case EVAL_VALUE_TYPE_CHAR: {
-    printf("%d\n", val.value.character);
+    printf("%d", value->value.character);
   } break;
   case EVAL_VALUE_TYPE_STRING: {
-    printf("%s\n", val.value.string);
+    EvalString *string = &value->value.string;
+    fwrite(evalStringData(string), sizeof(char), string->length, stdout);
+  } break;
+  case EVAL_VALUE_TYPE_ARRAY: {
+    EvalArray *array = &value->value.array;
+
+    printf("[");
+    for (u64 i = 0; i < array->length; ++i) {
+      if (i > 0) {
+        printf(", ");
+      }
+
+      i64 index = i;
+      EvalValue element = evalArrayGet(array, &index, 1);
+      evalPrintValue(&element);
+    }
+    printf("]");
+  } break;
+  case EVAL_VALUE_TYPE_MAP: {
+    EvalMapEntry *entries = evalMapEntries(value->value.map);
+
+    printf("{");
+    for (u64 i = 0; i < vectorLength(entries); ++i) {
+      if (i > 0) {
+        printf(", ");
+      }
+      evalPrintValue(&entries[i].key);
+      printf(": ");
+      evalPrintValue(&entries[i].value);
+    }
+    printf("}");
+    vectorDestroy(entries);
+  } break;
+  case EVAL_VALUE_TYPE_STRUCT: {
+    EvalStruct *structure = &value->value.structure;
+    EvalStructType *type = structure->type;
+
+    printf("%s{", type->name);
+    for (u32 i = 0; i < evalStructFieldCount(type); ++i) {
+      if (i > 0) {
+        printf(", ");
+      }
+      printf("%s: ", type->fields[i].name);
+      evalPrintValue(&structure->slots[i]);
+    }
+    printf("}");
+  } break;
+  case EVAL_VALUE_TYPE_STRUCT_TYPE: {
+    printf("struct %s", value->value.struct_type->name);
+  } break;
+  case EVAL_VALUE_TYPE_FUTURE: {
+    printf("future");
+  } break;
+  case EVAL_VALUE_TYPE_CHAN: {
+    printf("chan");
+  } break;
+  case EVAL_VALUE_TYPE_GENERATOR: {
+    printf("generator");
   } break;
   default: {
     ERROR("liv: failed to print type!");
   } break;
   };
+}
+
+static void evalIndices(ASTNode *node, u32 first, u32 count, i64 *indices,
+                        Environment *env) {
+  for (u32 i = 0; i < count; ++i) {
+    EvalValue index_value = eval(&node->children[first + i], env);
+    if (!evalIsNumber(index_value.type)) {
+      RAISE("liv: [] argument is not a number!");
+    }
+
+    indices[i] = (i64)evalRetrieveNumber(&index_value);
+  }
+}
+
+/* bindings of frozen scopes are shared with parallel code */
+static void evalSetVariable(Environment *env, char *name, EvalValue value) {
+  if (!environmentSet(env, name, value)) {
+    RAISE("liv: %s is shared with parallel code and read-only!", name);
+  }
+}
+
+static EvalValue evalConcat(EvalValue *left, EvalValue *right) {
+  EvalString left_string = evalToString(left);
+  EvalString right_string = evalToString(right);
 
   EvalValue result = {};
-  result.type = EVAL_VALUE_TYPE_UNKNOWN;
+  result.type = EVAL_VALUE_TYPE_STRING;
+  result.value.string = evalStringConcat(&left_string, &right_string);
 
   return result;
 }
 
+static i32 evalCompareStrings(EvalValue *left, EvalValue *right,
+                              const char *op) {
+  if (left->type != EVAL_VALUE_TYPE_STRING ||
+      right->type != EVAL_VALUE_TYPE_STRING) {
+    RAISE("liv: %s arguments are not both strings!", op);
+  }
+
+  return evalStringCompare(&left->value.string, &right->value.string);
+}
+
+/* string operand of a concatenation, numbers are formatted like print */
+static EvalString evalToString(EvalValue *value) {
+  char buf[64];
+  i32 length = 0;
+
+  switch (value->type) {
+  case EVAL_VALUE_TYPE_STRING: {
+    return value->value.string;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    return evalStringCreate(&value->value.character, 1);
+  } break;
+  case EVAL_VALUE_TYPE_INT: {
+    length = snprintf(buf, sizeof(buf), "%ld", value->value.integer);
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    length = snprintf(buf, sizeof(buf), "%f", value->value.floating);
+  } break;
+  default: {
+    RAISE("liv: + argument cannot be converted to a string!");
+  } break;
+  };
+
+  return evalStringCreate(buf, length);
+}
+
+/* {x, y} with the layout of the declared struct type */
+static EvalValue evalStructLiteral(EvalStructType *type, ASTNode *node,
+                                   Environment *env) {
+  u32 count = vectorLength(node->children);
+  if (count != evalStructFieldCount(type)) {
+    RAISE("liv: struct literal does not match the fields of %s!", type->name);
+  }
+
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_STRUCT;
+  result.value.structure = evalStructCreate(type);
+
+  for (u32 i = 0; i < count; ++i) {
+    ASTNode *lit = &node->children[i];
+    EvalStructType *field_type = type->fields[i].struct_type;
+
+    EvalValue field = {};
+    if (field_type && lit->type == AST_NODE_TYPE_STRUCTLIT) {
+      field = evalStructLiteral(field_type, lit, env);
+    } else {
+      field = eval(lit, env);
+    }
+
+    evalFieldStore(&result.value.structure, i, &field);
+  }
+
+  return result;
+}
+
+/* the node value caches (type id << 32 | slot) of the last struct type seen
+ * here, so a hot field access skips the name lookup */
+static u64 evalFieldSlot(ASTNode *node, EvalStruct *structure) {
+  EvalStructType *type = structure->type;
+
+  u64 cache = __atomic_load_n((u64 *)&node->value.integer, __ATOMIC_RELAXED);
+  if ((cache >> 32) == type->id) {
+    return cache & 0xffffffff;
+  }
+
+  char *name = node->children[1].value.identifier;
+  i64 slot = evalStructFieldSlot(type, name);
+  if (slot < 0) {
+    RAISE("liv: struct %s has no field %s!", type->name, name);
+  }
+
+  cache = ((u64)type->id << 32) | (u64)slot;
+  __atomic_store_n((u64 *)&node->value.integer, cache, __ATOMIC_RELAXED);
+
+  return slot;
+}
+
+/* the layout is fixed, numbers are converted to the field type */
+static void evalFieldStore(EvalStruct *structure, u64 slot, EvalValue *value) {
+  EvalStructField *field = &structure->type->fields[slot];
+  EvalValue *target = &structure->slots[slot];
+
+  if (evalIsNumber(field->type) && evalIsNumber(value->type)) {
+    EvalValue converted = {};
+    converted.type = field->type;
+    evalSetNumberByType(&converted, evalRetrieveNumber(value));
+
+    *target = converted;
+    return;
+  }
+
+  if (value->type != field->type ||
+      (field->struct_type &&
+       value->value.structure.type != field->struct_type)) {
+    RAISE("liv: value does not match the type of field %s!", field->name);
+  }
+
+  *target = *value;
+  target->payload = EVAL_PAYLOAD_TYPE_NONE;
+}
+
+static void evalArrayFill(ASTNode *init, EvalArray *array, u32 depth,
+                          u64 *position, Environment *env) {
+  u64 size = evalArraySize(array);
+
+  for (u32 i = 0; i < vectorLength(init->children); ++i) {
+    ASTNode *lit = &init->children[i];
+    if (lit->type == AST_NODE_TYPE_STRUCTLIT && depth + 1 < array->rank) {
+      evalArrayFill(lit, array, depth + 1, position, env);
+      continue;
+    }
+
+    if (*position >= size) {
+      RAISE("liv: specified array size does not match to number of "
+            "elements!");
+    }
+
+    EvalValue element = eval(lit, env);
+    evalArrayStore(array, array->offset + (*position)++, &element);
+  }
+}
+
 /* astnodetype to EvalValueType */
 static u8 evalAnttoevt(u8 type) {
   switch (type) {
@@ -1244,6 +2184,49 @@ static u8 evalAnttoevt(u8 type) {
   return EVAL_VALUE_TYPE_UNKNOWN;
 }
 
+static u8 evalTypeOf(ASTNode *type_node, Environment *env) {
+  if (type_node->type != AST_NODE_TYPE_IDENT) {
+    return evalAnttoevt(type_node->type);
+  }
+
+  char *name = type_node->value.identifier;
+  if (!strcmp(name, "array")) {
+    return EVAL_VALUE_TYPE_ARRAY;
+  }
+  if (!strcmp(name, "map")) {
+    return EVAL_VALUE_TYPE_MAP;
+  }
+  if (!strcmp(name, "future")) {
+    return EVAL_VALUE_TYPE_FUTURE;
+  }
+  if (!strcmp(name, "chan")) {
+    return EVAL_VALUE_TYPE_CHAN;
+  }
+  if (!strcmp(name, "generator")) {
+    return EVAL_VALUE_TYPE_GENERATOR;
+  }
+  if (evalStructTypeOf(type_node, env)) {
+    return EVAL_VALUE_TYPE_STRUCT;
+  }
+
+  return EVAL_VALUE_TYPE_UNKNOWN;
+}
+
+/* struct declaration named by the type, null for any other type */
+static EvalStructType *evalStructTypeOf(ASTNode *type_node, Environment *env) {
+  if (type_node->type != AST_NODE_TYPE_IDENT) {
+    return 0;
+  }
+
+  EvalValue value = {};
+  if (!environmentSearch(env, type_node->value.identifier, &value) ||
+      value.type != EVAL_VALUE_TYPE_STRUCT_TYPE) {
+    return 0;
+  }
+
+  return value.value.struct_type;
+}
+
 static f64 evalRetrieveNumber(EvalValue *value) {
   f64 val = 0;
   switch (value->type) {
@@ -1290,6 +2273,6 @@ static u8 evalDominantType(u8 left, u8 right) {
 }
 
 static b8 evalIsNumber(u8 type) {
-  return type == EVAL_VALUE_TYPE_CHAR || EVAL_VALUE_TYPE_FLOAT ||
-         EVAL_VALUE_TYPE_INT;
+  return type == EVAL_VALUE_TYPE_CHAR || type == EVAL_VALUE_TYPE_FLOAT ||
+         type == EVAL_VALUE_TYPE_INT;
 }
\ No newline at end of file
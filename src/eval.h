@@ -3,4 +3,8 @@
 #include "ast_node.h"
 #include "environment.h"
 
-EvalValue eval(ASTNode *node, Environment *env);
\ No newline at end of file
+EvalValue eval(ASTNode *node, Environment *env);
+/* calls a script function or a native on evaluated arguments, a script
+ * function's scope is opened under env */
+EvalValue evalApply(const char *fn_name, EvalValue *function, EvalValue *args,
+                    u32 argc, Environment *env);
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include "eval_array.h"
+
+#include "error.h"
+
+#include <stdlib.h>
+
+static u64 evalArrayStride(EvalArray *array);
+static u64 evalArrayCheckIndex(i64 index, u64 extent);
+
+EvalArray evalArrayCreate(u64 *extents, u8 rank, u8 element_type) {
+  EvalArray array = {};
+  array.offset = 0;
+  array.length = extents[0];
+  array.rank = rank;
+  array.dims = 0;
+  array.element_type = element_type;
+
+  if (rank > 1) {
+    array.dims = malloc(sizeof(u64) * (rank - 1));
+    for (u8 i = 1; i < rank; ++i) {
+      array.dims[i - 1] = extents[i];
+    }
+  }
+
+  u64 size = evalArraySize(&array);
+  array.elements = calloc(size ? size : 1, evalArrayElementSize(element_type));
+
+  if (!evalArrayIsNumeric(&array)) {
+    EvalValue *elements = array.elements;
+    for (u64 i = 0; i < size; ++i) {
+      elements[i].type = element_type;
+    }
+  }
+
+  return array;
+}
+
+u64 evalArraySize(EvalArray *array) {
+  return array->length * evalArrayStride(array);
+}
+
+u64 evalArrayOffset(EvalArray *array, i64 *indices, u32 count) {
+  if (count > array->rank) {
+    RAISE("liv: %u indices given for an array of rank %u!", count,
+          array->rank);
+  }
+
+  /* horner's scheme over the extents, a single pass for every index */
+  u64 index = evalArrayCheckIndex(indices[0], array->length);
+  for (u32 i = 1; i < array->rank; ++i) {
+    index *= array->dims[i - 1];
+    if (i < count) {
+      index += evalArrayCheckIndex(indices[i], array->dims[i - 1]);
+    }
+  }
+
+  return array->offset + index;
+}
+
+b8 evalArrayIsNumeric(EvalArray *array) {
+  return array->element_type == EVAL_VALUE_TYPE_INT ||
+         array->element_type == EVAL_VALUE_TYPE_FLOAT ||
+         array->element_type == EVAL_VALUE_TYPE_CHAR;
+}
+
+void *evalArrayData(EvalArray *array) {
+  return (char *)array->elements +
+         array->offset * evalArrayElementSize(array->element_type);
+}
+
+u64 evalArrayElementSize(u8 element_type) {
+  switch (element_type) {
+  case EVAL_VALUE_TYPE_INT: {
+    return sizeof(i64);
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    return sizeof(f64);
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    return sizeof(char);
+  } break;
+  };
+
+  return sizeof(EvalValue);
+}
+
+EvalValue evalArrayLoad(EvalArray *array, u64 offset) {
+  EvalValue value = {};
+  value.type = array->element_type;
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_INT: {
+    value.value.integer = ((i64 *)array->elements)[offset];
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    value.value.floating = ((f64 *)array->elements)[offset];
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    value.value.character = ((char *)array->elements)[offset];
+  } break;
+  default: {
+    value = ((EvalValue *)array->elements)[offset];
+  } break;
+  };
+
+  return value;
+}
+
+/* numbers are converted to the element type of a numeric array */
+void evalArrayStore(EvalArray *array, u64 offset, EvalValue *value) {
+  if (!evalArrayIsNumeric(array)) {
+    ((EvalValue *)array->elements)[offset] = *value;
+    return;
+  }
+
+  f64 number = 0;
+  switch (value->type) {
+  case EVAL_VALUE_TYPE_INT: {
+    number = value->value.integer;
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    number = value->value.floating;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    number = value->value.character;
+  } break;
+  default: {
+    RAISE("liv: cannot store a non-number in a numeric array!");
+  } break;
+  };
+
+  switch (array->element_type) {
+  case EVAL_VALUE_TYPE_INT: {
+    /* keep the full 64 bits when no conversion is needed */
+    ((i64 *)array->elements)[offset] = value->type == EVAL_VALUE_TYPE_INT
+                                           ? value->value.integer
+                                           : (i64)number;
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    ((f64 *)array->elements)[offset] = number;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    ((char *)array->elements)[offset] = (char)number;
+  } break;
+  };
+}
+
+EvalValue evalArrayGet(EvalArray *array, i64 *indices, u32 count) {
+  u64 offset = evalArrayOffset(array, indices, count);
+  if (count == array->rank) {
+    return evalArrayLoad(array, offset);
+  }
+
+  /* partial indexing gives a view of the remaining dimensions */
+  EvalValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = *array;
+  result.value.array.offset = offset;
+  result.value.array.length = array->dims[count - 1];
+  result.value.array.dims = array->dims + count;
+  result.value.array.rank = array->rank - count;
+
+  return result;
+}
+
+EvalArray evalArraySlice(EvalArray *array, i64 lo, i64 hi) {
+  if (lo < 0 || hi < lo || hi > array->length) {
+    RAISE("liv: slice [%ld:%ld] is out of range [0, %lu]!", lo, hi,
+          array->length);
+  }
+
+  /* the view shares the elements, only the window is moved */
+  EvalArray slice = *array;
+  slice.offset = array->offset + lo * evalArrayStride(array);
+  slice.length = hi - lo;
+
+  return slice;
+}
+
+static u64 evalArrayStride(EvalArray *array) {
+  u64 stride = 1;
+  for (u8 i = 1; i < array->rank; ++i) {
+    stride *= array->dims[i - 1];
+  }
+
+  return stride;
+}
+
+static u64 evalArrayCheckIndex(i64 index, u64 extent) {
+  if (index < 0 || index >= extent) {
+    RAISE("liv: array index %ld is out of range [0, %lu)!", index, extent);
+  }
+
+  return index;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+EvalArray evalArrayCreate(u64 *extents, u8 rank, u8 element_type);
+
+u64 evalArraySize(EvalArray *array);
+u64 evalArrayOffset(EvalArray *array, i64 *indices, u32 count);
+
+/* true if the elements are stored unboxed, see EvalArray */
+b8 evalArrayIsNumeric(EvalArray *array);
+u64 evalArrayElementSize(u8 element_type);
+/* first element of the view */
+void *evalArrayData(EvalArray *array);
+
+/* element at an absolute offset, as returned by evalArrayOffset */
+EvalValue evalArrayLoad(EvalArray *array, u64 offset);
+void evalArrayStore(EvalArray *array, u64 offset, EvalValue *value);
+
+EvalValue evalArrayGet(EvalArray *array, i64 *indices, u32 count);
+EvalArray evalArraySlice(EvalArray *array, i64 lo, i64 hi);
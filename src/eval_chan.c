@@ -0,0 +1,176 @@
+#include "eval_chan.h"
+
+#include "error.h"
+#include "thread_pool.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#define CHAN_WAIT_NANOSECONDS 1000000
+#define CHAN_CLOSED (1ull << 63)
+
+static void evalChanSleep(EvalChan *chan, b8 sending);
+static void evalChanWake(EvalChan *chan);
+static b8 evalChanReady(EvalChan *chan, b8 sending);
+
+EvalChan *evalChanCreate(u64 capacity) {
+  if (capacity == 0) {
+    RAISE("liv: channel capacity must not be zero!");
+  }
+
+  EvalChan *chan = calloc(1, sizeof(EvalChan));
+  chan->slots = malloc(sizeof(EvalChanSlot) * capacity);
+  chan->capacity = capacity;
+  for (u64 i = 0; i < capacity; ++i) {
+    chan->slots[i].sequence = 2 * i;
+  }
+
+  pthread_mutex_init(&chan->lock, 0);
+  pthread_cond_init(&chan->changed, 0);
+
+  return chan;
+}
+
+/* a slot at position p is free for the sender when its sequence is 2p, and
+ * holds a value for the receiver when it is 2p + 1. the receiver hands it
+ * back for the next lap by setting 2(p + capacity). the doubling keeps the
+ * states apart for a capacity of one */
+b8 evalChanTrySend(EvalChan *chan, EvalValue *value) {
+  u64 position = __atomic_load_n(&chan->tail, __ATOMIC_RELAXED);
+  for (;;) {
+    /* the close sets the bit in tail, so a claim either lands before it and
+     * is delivered or fails and sees it */
+    if (position & CHAN_CLOSED) {
+      RAISE("liv: send on a closed channel!");
+    }
+
+    EvalChanSlot *slot = &chan->slots[position % chan->capacity];
+    u64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+    if (sequence == 2 * position) {
+      if (__atomic_compare_exchange_n(&chan->tail, &position, position + 1,
+                                      true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        slot->value = *value;
+        __atomic_store_n(&slot->sequence, 2 * position + 1, __ATOMIC_RELEASE);
+        evalChanWake(chan);
+
+        return true;
+      }
+    } else if (sequence < 2 * position) {
+      /* the slot still holds last lap's value, the ring is full */
+      return false;
+    } else {
+      position = __atomic_load_n(&chan->tail, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+void evalChanSend(EvalChan *chan, EvalValue *value) {
+  while (!evalChanTrySend(chan, value)) {
+    evalChanSleep(chan, true);
+  }
+}
+
+b8 evalChanTryRecv(EvalChan *chan, EvalValue *out_value) {
+  u64 position = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+  for (;;) {
+    EvalChanSlot *slot = &chan->slots[position % chan->capacity];
+    u64 sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+
+    if (sequence == 2 * position + 1) {
+      if (__atomic_compare_exchange_n(&chan->head, &position, position + 1,
+                                      true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        *out_value = slot->value;
+        __atomic_store_n(&slot->sequence, 2 * (position + chan->capacity),
+                         __ATOMIC_RELEASE);
+        evalChanWake(chan);
+
+        return true;
+      }
+    } else if (sequence < 2 * position + 1) {
+      /* nothing was sent into the slot yet, the ring is empty */
+      return false;
+    } else {
+      position = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+b8 evalChanRecv(EvalChan *chan, EvalValue *out_value) {
+  for (;;) {
+    if (evalChanTryRecv(chan, out_value)) {
+      return true;
+    }
+
+    /* values claimed before the close are still delivered, a sender may
+     * not have published its value yet */
+    u64 tail = __atomic_load_n(&chan->tail, __ATOMIC_ACQUIRE);
+    if (tail & CHAN_CLOSED) {
+      u64 head = __atomic_load_n(&chan->head, __ATOMIC_RELAXED);
+      if (head == (tail & ~CHAN_CLOSED)) {
+        return false;
+      }
+    }
+
+    evalChanSleep(chan, false);
+  }
+}
+
+void evalChanClose(EvalChan *chan) {
+  pthread_mutex_lock(&chan->lock);
+  __atomic_fetch_or(&chan->tail, CHAN_CLOSED, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&chan->changed);
+  pthread_mutex_unlock(&chan->lock);
+}
+
+/* the other end of the channel may still be queued, the pool keeps a
+ * worker free for it. the timeout covers a wake racing with the sleep */
+static void evalChanSleep(EvalChan *chan, b8 sending) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += CHAN_WAIT_NANOSECONDS;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  threadPoolBlockBegin();
+
+  pthread_mutex_lock(&chan->lock);
+  __atomic_add_fetch(&chan->sleepers, 1, __ATOMIC_SEQ_CST);
+  if (!evalChanReady(chan, sending)) {
+    pthread_cond_timedwait(&chan->changed, &chan->lock, &deadline);
+  }
+  __atomic_sub_fetch(&chan->sleepers, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&chan->lock);
+
+  threadPoolBlockEnd();
+}
+
+static void evalChanWake(EvalChan *chan) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&chan->sleepers, __ATOMIC_SEQ_CST) == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&chan->lock);
+  pthread_cond_broadcast(&chan->changed);
+  pthread_mutex_unlock(&chan->lock);
+}
+
+/* whether the operation a sleeper waits for could make progress */
+static b8 evalChanReady(EvalChan *chan, b8 sending) {
+  u64 head = __atomic_load_n(&chan->head, __ATOMIC_ACQUIRE);
+  u64 tail = __atomic_load_n(&chan->tail, __ATOMIC_ACQUIRE);
+  if (tail & CHAN_CLOSED) {
+    return true;
+  }
+
+  if (sending) {
+    return tail - head < chan->capacity;
+  }
+
+  return tail != head;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+EvalChan *evalChanCreate(u64 capacity);
+
+/* the try variants return false instead of waiting. sending on a closed
+ * channel fails */
+b8 evalChanTrySend(EvalChan *chan, EvalValue *value);
+void evalChanSend(EvalChan *chan, EvalValue *value);
+
+/* the blocking receive returns false once the channel is closed and empty */
+b8 evalChanTryRecv(EvalChan *chan, EvalValue *out_value);
+b8 evalChanRecv(EvalChan *chan, EvalValue *out_value);
+
+void evalChanClose(EvalChan *chan);
@@ -0,0 +1,372 @@
+#include "eval_generator.h"
+
+#include "error.h"
+#include "eval.h"
+#include "eval_array.h"
+#include "eval_chan.h"
+#include "parser.h"
+#include "vector.h"
+
+#include <stdlib.h>
+
+/* step is the resume point inside the node: the next statement of a block,
+ * or the phase of a loop */
+typedef struct EvalGeneratorFrame {
+  ASTNode *node;
+  u32 step;
+  Environment *env;
+  /* blocks and for loops open a scope, the other frames borrow one */
+  b8 owned;
+  EvalIterator iterator;
+} EvalGeneratorFrame;
+
+enum {
+  EVAL_GENERATOR_STEP_INIT,
+  EVAL_GENERATOR_STEP_TEST,
+  EVAL_GENERATOR_STEP_POST,
+};
+
+static b8 evalGeneratorResume(EvalGenerator *generator, EvalValue *out_value);
+static void evalGeneratorPush(EvalGenerator *generator, ASTNode *node,
+                              Environment *env);
+static void evalGeneratorPop(EvalGenerator *generator);
+static void evalGeneratorFinish(EvalGenerator *generator);
+static void evalGeneratorUnwind(EvalGenerator *generator, u8 payload);
+static b8 evalGeneratorStatement(EvalGenerator *generator, ASTNode *node,
+                                 Environment *env, EvalValue *out_value);
+static b8 evalGeneratorTest(ASTNode *node, Environment *env, const char *name);
+static i64 evalGeneratorBound(ASTNode *node, Environment *env);
+static b8 evalGeneratorIsLoop(ASTNode *node);
+
+b8 evalGeneratorYields(ASTNode *node) {
+  if (node->type == AST_NODE_TYPE_YIELD) {
+    return true;
+  }
+  if (node->type == AST_NODE_TYPE_LAZY_BLOCK) {
+    return node->value.body->yields;
+  }
+  if (node->type == AST_NODE_TYPE_FUN || !node->children) {
+    return false;
+  }
+
+  for (u32 i = 0; i < vectorLength(node->children); ++i) {
+    if (evalGeneratorYields(&node->children[i])) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+EvalGenerator *evalGeneratorCreate(ASTNode *block, Environment *scope) {
+  EvalGenerator *generator = malloc(sizeof(EvalGenerator));
+  generator->block = *block;
+  generator->frames = vectorCreate(EvalGeneratorFrame);
+  generator->scope = scope;
+  generator->running = false;
+
+  evalGeneratorPush(generator, &generator->block, scope);
+
+  return generator;
+}
+
+/* an error in the body ends the generator, its scopes are released before
+ * the error reaches the caller */
+b8 evalGeneratorNext(EvalGenerator *generator, EvalValue *out_value) {
+  if (generator->running) {
+    RAISE("liv: generator is already running!");
+  }
+  generator->running = true;
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    evalGeneratorFinish(generator);
+    generator->running = false;
+    errorRethrow(&trap.error);
+  }
+
+  b8 yielded = evalGeneratorResume(generator, out_value);
+  errorTrapPop(&trap);
+  generator->running = false;
+
+  return yielded;
+}
+
+void evalIteratorCreate(EvalValue *source, EvalIterator *out_iterator) {
+  if (source->type != EVAL_VALUE_TYPE_GENERATOR &&
+      source->type != EVAL_VALUE_TYPE_CHAN &&
+      source->type != EVAL_VALUE_TYPE_ARRAY) {
+    RAISE("liv: for in argument is not iterable!");
+  }
+
+  out_iterator->source = *source;
+  out_iterator->position = 0;
+  out_iterator->end = 0;
+  if (source->type == EVAL_VALUE_TYPE_ARRAY) {
+    out_iterator->end = source->value.array.length;
+  }
+}
+
+/* the source of a range is the int counter itself */
+void evalIteratorCreateRange(i64 lo, i64 hi, EvalIterator *out_iterator) {
+  out_iterator->source.type = EVAL_VALUE_TYPE_INT;
+  out_iterator->position = lo;
+  out_iterator->end = hi;
+}
+
+b8 evalIteratorNext(EvalIterator *iterator, EvalValue *out_value) {
+  EvalValue *source = &iterator->source;
+  switch (source->type) {
+  case EVAL_VALUE_TYPE_GENERATOR: {
+    return evalGeneratorNext(source->value.generator, out_value);
+  } break;
+  case EVAL_VALUE_TYPE_CHAN: {
+    return evalChanRecv(source->value.chan, out_value);
+  } break;
+  case EVAL_VALUE_TYPE_ARRAY: {
+    if (iterator->position == iterator->end) {
+      return false;
+    }
+
+    *out_value = evalArrayGet(&source->value.array, &iterator->position, 1);
+    iterator->position++;
+    return true;
+  } break;
+  case EVAL_VALUE_TYPE_INT: {
+    if (iterator->position >= iterator->end) {
+      return false;
+    }
+
+    EvalValue value = {};
+    value.type = EVAL_VALUE_TYPE_INT;
+    value.value.integer = iterator->position++;
+    *out_value = value;
+    return true;
+  } break;
+  };
+
+  return false;
+}
+
+static b8 evalGeneratorResume(EvalGenerator *generator, EvalValue *out_value) {
+  while (generator->frames && vectorLength(generator->frames) > 0) {
+    EvalGeneratorFrame *frame =
+        &generator->frames[vectorLength(generator->frames) - 1];
+    ASTNode *node = frame->node;
+    Environment *env = frame->env;
+
+    switch (node->type) {
+    case AST_NODE_TYPE_BLOCK: {
+      if (frame->step == vectorLength(node->children)) {
+        evalGeneratorPop(generator);
+        break;
+      }
+
+      ASTNode *statement = &node->children[frame->step++];
+      if (evalGeneratorStatement(generator, statement, env, out_value)) {
+        return true;
+      }
+    } break;
+    case AST_NODE_TYPE_IF: {
+      /* the taken branch replaces the if */
+      evalGeneratorPop(generator);
+
+      if (evalGeneratorTest(&node->children[0], env, "if")) {
+        evalGeneratorPush(generator, &node->children[1], env);
+      } else if (vectorLength(node->children) == 3) {
+        evalGeneratorPush(generator, &node->children[2].children[0], env);
+      }
+    } break;
+    case AST_NODE_TYPE_WHILE: {
+      if (evalGeneratorTest(&node->children[0], env, "while")) {
+        evalGeneratorPush(generator, &node->children[1], env);
+      } else {
+        evalGeneratorPop(generator);
+      }
+    } break;
+    case AST_NODE_TYPE_FOR: {
+      if (frame->step == EVAL_GENERATOR_STEP_INIT) {
+        frame->step = EVAL_GENERATOR_STEP_TEST;
+        eval(&node->children[0], env);
+      } else if (frame->step == EVAL_GENERATOR_STEP_POST) {
+        frame->step = EVAL_GENERATOR_STEP_TEST;
+        eval(&node->children[2], env);
+      } else if (evalGeneratorTest(&node->children[1], env, "for")) {
+        frame->step = EVAL_GENERATOR_STEP_POST;
+        evalGeneratorPush(generator, &node->children[3], env);
+      } else {
+        evalGeneratorPop(generator);
+      }
+    } break;
+    case AST_NODE_TYPE_FOR_IN:
+    case AST_NODE_TYPE_FOR_RANGE: {
+      /* the scope holds only the loop variable */
+      if (frame->step == EVAL_GENERATOR_STEP_INIT) {
+        frame->step = EVAL_GENERATOR_STEP_TEST;
+
+        if (node->type == AST_NODE_TYPE_FOR_RANGE) {
+          i64 lo = evalGeneratorBound(&node->children[1], env);
+          i64 hi = evalGeneratorBound(&node->children[2], env);
+          evalIteratorCreateRange(lo, hi, &frame->iterator);
+        } else {
+          EvalValue source = eval(&node->children[1], env);
+          evalIteratorCreate(&source, &frame->iterator);
+        }
+
+        EvalValue none = {};
+        environmentEmplace(env, node->children[0].value.identifier, none);
+        break;
+      }
+
+      EvalValue item = {};
+      if (!evalIteratorNext(&frame->iterator, &item)) {
+        evalGeneratorPop(generator);
+        break;
+      }
+
+      env->variables[0].value = item;
+      ASTNode *block = &node->children[vectorLength(node->children) - 1];
+      evalGeneratorPush(generator, block, env);
+    } break;
+    default: {
+      RAISE("liv: unexpected statement in a generator!");
+    } break;
+    };
+  }
+
+  evalGeneratorFinish(generator);
+
+  return false;
+}
+
+static void evalGeneratorPush(EvalGenerator *generator, ASTNode *node,
+                              Environment *env) {
+  EvalGeneratorFrame frame = {};
+  frame.node = node;
+  frame.step = EVAL_GENERATOR_STEP_INIT;
+  frame.env = env;
+
+  if (node->type == AST_NODE_TYPE_BLOCK || node->type == AST_NODE_TYPE_FOR ||
+      node->type == AST_NODE_TYPE_FOR_IN ||
+      node->type == AST_NODE_TYPE_FOR_RANGE) {
+    frame.env = malloc(sizeof(Environment));
+    frame.owned = true;
+    environmentCreate(env, frame.env);
+  }
+
+  vectorPush(generator->frames, frame);
+}
+
+static void evalGeneratorPop(EvalGenerator *generator) {
+  EvalGeneratorFrame frame;
+  vectorPop(generator->frames, &frame);
+
+  if (frame.owned) {
+    environmentDestroy(frame.env);
+    free(frame.env);
+  }
+}
+
+static void evalGeneratorFinish(EvalGenerator *generator) {
+  if (!generator->frames) {
+    return;
+  }
+
+  while (vectorLength(generator->frames) > 0) {
+    evalGeneratorPop(generator);
+  }
+  vectorDestroy(generator->frames);
+  generator->frames = 0;
+
+  environmentDestroy(generator->scope);
+  free(generator->scope);
+  generator->scope = 0;
+}
+
+/* break leaves the innermost loop, continue resumes it. out of a loop both
+ * end the body like return does */
+static void evalGeneratorUnwind(EvalGenerator *generator, u8 payload) {
+  while (vectorLength(generator->frames) > 0) {
+    EvalGeneratorFrame *frame =
+        &generator->frames[vectorLength(generator->frames) - 1];
+    if (evalGeneratorIsLoop(frame->node)) {
+      if (payload == EVAL_PAYLOAD_TYPE_BREAK) {
+        evalGeneratorPop(generator);
+      }
+      return;
+    }
+
+    evalGeneratorPop(generator);
+  }
+}
+
+/* control statements become frames so a yield inside them can suspend,
+ * everything else runs to completion through eval */
+static b8 evalGeneratorStatement(EvalGenerator *generator, ASTNode *node,
+                                 Environment *env, EvalValue *out_value) {
+  errorLocate(node->line);
+
+  switch (node->type) {
+  case AST_NODE_TYPE_YIELD: {
+    *out_value = eval(&node->children[0], env);
+    out_value->payload = EVAL_PAYLOAD_TYPE_NONE;
+    return true;
+  } break;
+  case AST_NODE_TYPE_BLOCK:
+  case AST_NODE_TYPE_IF:
+  case AST_NODE_TYPE_WHILE:
+  case AST_NODE_TYPE_FOR:
+  case AST_NODE_TYPE_FOR_IN:
+  case AST_NODE_TYPE_FOR_RANGE: {
+    evalGeneratorPush(generator, node, env);
+    return false;
+  } break;
+  };
+
+  EvalValue result = eval(node, env);
+  switch (result.payload) {
+  case EVAL_PAYLOAD_TYPE_RETURN: {
+    evalGeneratorFinish(generator);
+  } break;
+  case EVAL_PAYLOAD_TYPE_BREAK:
+  case EVAL_PAYLOAD_TYPE_CONTINUE: {
+    evalGeneratorUnwind(generator, result.payload);
+  } break;
+  };
+
+  return false;
+}
+
+static b8 evalGeneratorTest(ASTNode *node, Environment *env, const char *name) {
+  EvalValue cond = eval(node, env);
+  if (cond.type != EVAL_VALUE_TYPE_INT && cond.type != EVAL_VALUE_TYPE_FLOAT &&
+      cond.type != EVAL_VALUE_TYPE_CHAR) {
+    RAISE("liv: %s argument is not a number!", name);
+  }
+
+  return cond.value.character != 0;
+}
+
+static i64 evalGeneratorBound(ASTNode *node, Environment *env) {
+  EvalValue bound = eval(node, env);
+  switch (bound.type) {
+  case EVAL_VALUE_TYPE_INT: {
+    return bound.value.integer;
+  } break;
+  case EVAL_VALUE_TYPE_FLOAT: {
+    return (i64)bound.value.floating;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    return bound.value.character;
+  } break;
+  };
+
+  RAISE("liv: range bound is not a number!");
+}
+
+static b8 evalGeneratorIsLoop(ASTNode *node) {
+  return node->type == AST_NODE_TYPE_WHILE || node->type == AST_NODE_TYPE_FOR ||
+         node->type == AST_NODE_TYPE_FOR_IN ||
+         node->type == AST_NODE_TYPE_FOR_RANGE;
+}
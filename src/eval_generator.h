@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ast_node.h"
+#include "defines.h"
+#include "environment.h"
+#include "eval_value.h"
+
+struct EvalGeneratorFrame;
+
+/* suspended call of a function that yields. the body runs on a stack of
+ * frames, one per statement being executed, instead of the c stack, so a
+ * yield only returns from evalGeneratorNext and the next call resumes from
+ * the top frame. a generator has one consumer at a time */
+typedef struct EvalGenerator {
+  ASTNode block;
+  struct EvalGeneratorFrame *frames;
+  /* scope holding the arguments, owned by the generator */
+  Environment *scope;
+  b8 running;
+} EvalGenerator;
+
+/* source of a for in loop. generators and channels are consumed lazily,
+ * arrays and ranges are walked by position up to end */
+typedef struct EvalIterator {
+  EvalValue source;
+  i64 position;
+  i64 end;
+} EvalIterator;
+
+/* whether a function body yields, nested functions are not searched */
+b8 evalGeneratorYields(ASTNode *node);
+
+EvalGenerator *evalGeneratorCreate(ASTNode *block, Environment *scope);
+/* false once the body has finished */
+b8 evalGeneratorNext(EvalGenerator *generator, EvalValue *out_value);
+
+void evalIteratorCreate(EvalValue *source, EvalIterator *out_iterator);
+void evalIteratorCreateRange(i64 lo, i64 hi, EvalIterator *out_iterator);
+b8 evalIteratorNext(EvalIterator *iterator, EvalValue *out_value);
@@ -0,0 +1,305 @@
+#include "eval_map.h"
+
+#include "error.h"
+#include "eval_string.h"
+#include "vector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MAP_GROUP_WIDTH 16
+#define MAP_DEFAULT_CAPACITY 16
+#define MAP_CONTROL_EMPTY ((i8)-128)
+#define MAP_CONTROL_DELETED ((i8)-2)
+
+static void evalMapAllocate(EvalMap *map, u64 capacity);
+static void evalMapGrow(EvalMap *map);
+static void evalMapCheckFrozen(EvalMap *map);
+static i64 evalMapFind(EvalMap *map, EvalValue *key, u64 hash);
+static u64 evalMapInsertSlot(EvalMap *map, u64 hash);
+
+static u32 evalMapMatch(i8 *group, i8 tag);
+static u32 evalMapMatchEmpty(i8 *group);
+static u32 evalMapMatchFree(i8 *group);
+
+static u64 evalMapHash(EvalValue *key);
+static b8 evalMapKeyEquals(EvalValue *left, EvalValue *right);
+
+EvalMap *evalMapCreate() {
+  EvalMap *map = malloc(sizeof(EvalMap));
+  evalMapAllocate(map, MAP_DEFAULT_CAPACITY);
+  map->frozen = 0;
+  pthread_mutex_init(&map->lock, 0);
+
+  return map;
+}
+
+void evalMapDestroy(EvalMap *map) {
+  pthread_mutex_destroy(&map->lock);
+  free(map->control);
+  free(map->entries);
+  free(map);
+}
+
+b8 evalMapGet(EvalMap *map, EvalValue *key, EvalValue *out_value) {
+  u64 hash = evalMapHash(key);
+
+  pthread_mutex_lock(&map->lock);
+  i64 slot = evalMapFind(map, key, hash);
+  if (slot >= 0) {
+    *out_value = map->entries[slot].value;
+  }
+  pthread_mutex_unlock(&map->lock);
+
+  return slot >= 0;
+}
+
+/* the hash can raise, it is taken before the lock */
+void evalMapSet(EvalMap *map, EvalValue *key, EvalValue *value) {
+  evalMapCheckFrozen(map);
+
+  u64 hash = evalMapHash(key);
+
+  pthread_mutex_lock(&map->lock);
+  i64 slot = evalMapFind(map, key, hash);
+  if (slot >= 0) {
+    map->entries[slot].value = *value;
+    pthread_mutex_unlock(&map->lock);
+
+    return;
+  }
+
+  /* keep at least one empty slot in 8 so probes terminate early */
+  if ((map->length + map->tombstones + 1) * 8 > map->capacity * 7) {
+    evalMapGrow(map);
+  }
+
+  u64 free_slot = evalMapInsertSlot(map, hash);
+  if (map->control[free_slot] == MAP_CONTROL_DELETED) {
+    map->tombstones--;
+  }
+
+  map->control[free_slot] = hash & 0x7f;
+  map->entries[free_slot].key = *key;
+  map->entries[free_slot].value = *value;
+  map->length++;
+  pthread_mutex_unlock(&map->lock);
+}
+
+b8 evalMapRemove(EvalMap *map, EvalValue *key) {
+  evalMapCheckFrozen(map);
+
+  u64 hash = evalMapHash(key);
+
+  pthread_mutex_lock(&map->lock);
+  i64 slot = evalMapFind(map, key, hash);
+  if (slot >= 0) {
+    map->control[slot] = MAP_CONTROL_DELETED;
+    map->length--;
+    map->tombstones++;
+  }
+  pthread_mutex_unlock(&map->lock);
+
+  return slot >= 0;
+}
+
+u64 evalMapLength(EvalMap *map) {
+  pthread_mutex_lock(&map->lock);
+  u64 length = map->length;
+  pthread_mutex_unlock(&map->lock);
+
+  return length;
+}
+
+EvalMapEntry *evalMapEntries(EvalMap *map) {
+  pthread_mutex_lock(&map->lock);
+  EvalMapEntry *entries = vectorReserve(EvalMapEntry, map->length);
+  for (u64 i = 0; i < map->capacity; ++i) {
+    if (map->control[i] >= 0) {
+      vectorPush(entries, map->entries[i]);
+    }
+  }
+  pthread_mutex_unlock(&map->lock);
+
+  return entries;
+}
+
+static void evalMapAllocate(EvalMap *map, u64 capacity) {
+  map->control = malloc(capacity);
+  memset(map->control, MAP_CONTROL_EMPTY, capacity);
+  map->entries = malloc(sizeof(EvalMapEntry) * capacity);
+  map->capacity = capacity;
+  map->length = 0;
+  map->tombstones = 0;
+}
+
+static void evalMapGrow(EvalMap *map) {
+  EvalMap old = *map;
+
+  /* only tombstones are dropped when the live entries still fit */
+  u64 capacity = old.capacity;
+  if ((old.length + 1) * 2 > old.capacity) {
+    capacity *= 2;
+  }
+
+  evalMapAllocate(map, capacity);
+
+  for (u64 i = 0; i < old.capacity; ++i) {
+    if (old.control[i] < 0) {
+      continue;
+    }
+
+    EvalMapEntry *entry = &old.entries[i];
+    u64 hash = evalMapHash(&entry->key);
+    u64 slot = evalMapInsertSlot(map, hash);
+
+    map->control[slot] = hash & 0x7f;
+    map->entries[slot] = *entry;
+    map->length++;
+  }
+
+  free(old.control);
+  free(old.entries);
+}
+
+/* a frozen map is read by several threads at once, see environmentFreeze */
+static void evalMapCheckFrozen(EvalMap *map) {
+  if (__atomic_load_n(&map->frozen, __ATOMIC_RELAXED)) {
+    RAISE("liv: map is shared with parallel code and read-only!");
+  }
+}
+
+/* the upper hash bits pick the first group, the low 7 bits are the tag */
+static i64 evalMapFind(EvalMap *map, EvalValue *key, u64 hash) {
+  u64 groups = map->capacity / MAP_GROUP_WIDTH;
+  u64 group = (hash >> 7) & (groups - 1);
+  i8 tag = hash & 0x7f;
+
+  for (u64 probe = 0; probe < groups; ++probe) {
+    i8 *control = map->control + group * MAP_GROUP_WIDTH;
+
+    u32 mask = evalMapMatch(control, tag);
+    while (mask) {
+      u64 slot = group * MAP_GROUP_WIDTH + __builtin_ctz(mask);
+      if (evalMapKeyEquals(&map->entries[slot].key, key)) {
+        return slot;
+      }
+
+      mask &= mask - 1;
+    }
+
+    /* an empty slot ends the probe sequence, the key was never inserted
+     * further along */
+    if (evalMapMatchEmpty(control)) {
+      return -1;
+    }
+
+    group = (group + probe + 1) & (groups - 1);
+  }
+
+  return -1;
+}
+
+static u64 evalMapInsertSlot(EvalMap *map, u64 hash) {
+  u64 groups = map->capacity / MAP_GROUP_WIDTH;
+  u64 group = (hash >> 7) & (groups - 1);
+
+  for (u64 probe = 0;; ++probe) {
+    u32 mask = evalMapMatchFree(map->control + group * MAP_GROUP_WIDTH);
+    if (mask) {
+      return group * MAP_GROUP_WIDTH + __builtin_ctz(mask);
+    }
+
+    group = (group + probe + 1) & (groups - 1);
+  }
+}
+
+#ifdef __SSE2__
+static u32 evalMapMatch(i8 *group, i8 tag) {
+  __m128i control = _mm_loadu_si128((const __m128i *)group);
+
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(tag)));
+}
+
+static u32 evalMapMatchEmpty(i8 *group) {
+  return evalMapMatch(group, MAP_CONTROL_EMPTY);
+}
+
+/* empty and deleted are the only control bytes with the sign bit set */
+static u32 evalMapMatchFree(i8 *group) {
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+#else
+static u32 evalMapMatch(i8 *group, i8 tag) {
+  u32 mask = 0;
+  for (u32 i = 0; i < MAP_GROUP_WIDTH; ++i) {
+    mask |= (u32)(group[i] == tag) << i;
+  }
+
+  return mask;
+}
+
+static u32 evalMapMatchEmpty(i8 *group) {
+  return evalMapMatch(group, MAP_CONTROL_EMPTY);
+}
+
+static u32 evalMapMatchFree(i8 *group) {
+  u32 mask = 0;
+  for (u32 i = 0; i < MAP_GROUP_WIDTH; ++i) {
+    mask |= (u32)(group[i] < 0) << i;
+  }
+
+  return mask;
+}
+#endif
+
+static u64 evalMapHash(EvalValue *key) {
+  u64 hash = 0;
+
+  switch (key->type) {
+  case EVAL_VALUE_TYPE_INT: {
+    hash = (u64)key->value.integer;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    hash = (u64)(u8)key->value.character;
+  } break;
+  case EVAL_VALUE_TYPE_STRING: {
+    EvalString *string = &key->value.string;
+    hash = evalStringHash(evalStringData(string), string->length);
+  } break;
+  default: {
+    RAISE("liv: map keys must be int, char or string!");
+  } break;
+  };
+
+  /* splitmix64 finalizer, spreads sequential keys over the groups */
+  hash += key->type;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+
+  return hash ^ (hash >> 31);
+}
+
+static b8 evalMapKeyEquals(EvalValue *left, EvalValue *right) {
+  if (left->type != right->type) {
+    return false;
+  }
+
+  switch (left->type) {
+  case EVAL_VALUE_TYPE_INT: {
+    return left->value.integer == right->value.integer;
+  } break;
+  case EVAL_VALUE_TYPE_CHAR: {
+    return left->value.character == right->value.character;
+  } break;
+  case EVAL_VALUE_TYPE_STRING: {
+    return !evalStringCompare(&left->value.string, &right->value.string);
+  } break;
+  };
+
+  return false;
+}
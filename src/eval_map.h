@@ -0,0 +1,17 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+EvalMap *evalMapCreate();
+void evalMapDestroy(EvalMap *map);
+
+/* every operation takes the map lock, the map can be shared between tasks */
+b8 evalMapGet(EvalMap *map, EvalValue *key, EvalValue *out_value);
+/* both raise while the map is frozen */
+void evalMapSet(EvalMap *map, EvalValue *key, EvalValue *value);
+b8 evalMapRemove(EvalMap *map, EvalValue *key);
+u64 evalMapLength(EvalMap *map);
+
+/* copies the entries in slot order into a new vector */
+EvalMapEntry *evalMapEntries(EvalMap *map);
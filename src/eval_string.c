@@ -0,0 +1,209 @@
+#include "eval_string.h"
+
+#include "error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STRING_MIN_CAPACITY 16
+#define STRING_GROWTH_FACTOR 2
+#define STRING_INTERN_DEFAULT_CAPACITY 64
+
+typedef struct EvalStringTable {
+  EvalString *entries;
+  u64 capacity;
+  u64 length;
+} EvalStringTable;
+
+/* interned literals, equal literals share one buffer. each thread interns
+ * into its own table, so no lock is needed */
+static _Thread_local EvalStringTable intern_table = {};
+
+static EvalStringBuffer *evalStringBufferCreate(u64 capacity);
+static void evalStringTableGrow(EvalStringTable *table);
+static b8 evalStringEquals(EvalString *string, const char *data, u64 length);
+
+EvalString evalStringCreate(const char *data, u64 length) {
+  EvalString string = {};
+  memcpy(evalStringAllocate(length, &string), data, length);
+
+  return string;
+}
+
+EvalString evalStringIntern(const char *data, u64 length) {
+  EvalStringTable *table = &intern_table;
+  if ((table->length + 1) * 2 > table->capacity) {
+    evalStringTableGrow(table);
+  }
+
+  u64 mask = table->capacity - 1;
+  u64 slot = evalStringHash(data, length) & mask;
+  while (table->entries[slot].buffer) {
+    if (evalStringEquals(&table->entries[slot], data, length)) {
+      return table->entries[slot];
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  EvalString string = evalStringCreate(data, length);
+  table->entries[slot] = string;
+  table->length++;
+
+  return string;
+}
+
+/* the returned bytes are filled by the caller before the string is used */
+char *evalStringAllocate(u64 length, EvalString *out_string) {
+  EvalStringBuffer *buffer = evalStringBufferCreate(length);
+  buffer->length = length;
+
+  EvalString string = {};
+  string.buffer = buffer;
+  string.offset = 0;
+  string.length = length;
+  *out_string = string;
+
+  return buffer->data;
+}
+
+EvalString evalStringConcat(EvalString *left, EvalString *right) {
+  if (right->length == 0) {
+    return *left;
+  }
+  if (left->length == 0) {
+    return *right;
+  }
+
+  EvalStringBuffer *buffer = left->buffer;
+  u64 end = left->offset + left->length;
+  u64 length = left->length + right->length;
+
+  /* the left operand is the newest value in its buffer, nobody can observe
+   * the bytes past its end, so they are claimed instead of copying. the
+   * claim is atomic since parallel loops may append to one shared value */
+  u64 expected = end;
+  if (end + right->length <= buffer->capacity &&
+      __atomic_compare_exchange_n(&buffer->length, &expected,
+                                  end + right->length, false,
+                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    memcpy(buffer->data + end, evalStringData(right), right->length);
+
+    EvalString result = *left;
+    result.length = length;
+
+    return result;
+  }
+
+  u64 capacity = length * STRING_GROWTH_FACTOR;
+  if (capacity < STRING_MIN_CAPACITY) {
+    capacity = STRING_MIN_CAPACITY;
+  }
+
+  EvalStringBuffer *concat = evalStringBufferCreate(capacity);
+  memcpy(concat->data, evalStringData(left), left->length);
+  memcpy(concat->data + left->length, evalStringData(right), right->length);
+  concat->length = length;
+
+  EvalString result = {};
+  result.buffer = concat;
+  result.offset = 0;
+  result.length = length;
+
+  return result;
+}
+
+EvalString evalStringSlice(EvalString *string, i64 lo, i64 hi) {
+  if (lo < 0 || hi < lo || hi > string->length) {
+    RAISE("liv: slice [%ld:%ld] is out of range [0, %lu]!", lo, hi,
+          string->length);
+  }
+
+  EvalString slice = *string;
+  slice.offset = string->offset + lo;
+  slice.length = hi - lo;
+
+  return slice;
+}
+
+const char *evalStringData(EvalString *string) {
+  if (!string->buffer) {
+    return "";
+  }
+
+  return string->buffer->data + string->offset;
+}
+
+char evalStringAt(EvalString *string, i64 index) {
+  if (index < 0 || index >= string->length) {
+    RAISE("liv: string index %ld is out of range [0, %lu)!", index,
+          string->length);
+  }
+
+  return evalStringData(string)[index];
+}
+
+i32 evalStringCompare(EvalString *left, EvalString *right) {
+  if (left->buffer == right->buffer && left->offset == right->offset &&
+      left->length == right->length) {
+    return 0;
+  }
+
+  u64 length = left->length < right->length ? left->length : right->length;
+  i32 order = memcmp(evalStringData(left), evalStringData(right), length);
+  if (order != 0) {
+    return order;
+  }
+
+  return (left->length > right->length) - (left->length < right->length);
+}
+
+/* FNV-1a */
+u64 evalStringHash(const char *data, u64 length) {
+  u64 hash = 14695981039346656037ull;
+  for (u64 i = 0; i < length; ++i) {
+    hash ^= (u8)data[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+static EvalStringBuffer *evalStringBufferCreate(u64 capacity) {
+  EvalStringBuffer *buffer = malloc(sizeof(EvalStringBuffer) + capacity);
+  buffer->length = 0;
+  buffer->capacity = capacity;
+
+  return buffer;
+}
+
+static void evalStringTableGrow(EvalStringTable *table) {
+  EvalStringTable grown = {};
+  grown.capacity = table->capacity ? table->capacity * 2
+                                   : STRING_INTERN_DEFAULT_CAPACITY;
+  grown.entries = calloc(grown.capacity, sizeof(EvalString));
+
+  u64 mask = grown.capacity - 1;
+  for (u64 i = 0; i < table->capacity; ++i) {
+    EvalString *entry = &table->entries[i];
+    if (!entry->buffer) {
+      continue;
+    }
+
+    u64 slot = evalStringHash(evalStringData(entry), entry->length) & mask;
+    while (grown.entries[slot].buffer) {
+      slot = (slot + 1) & mask;
+    }
+
+    grown.entries[slot] = *entry;
+    grown.length++;
+  }
+
+  free(table->entries);
+  *table = grown;
+}
+
+static b8 evalStringEquals(EvalString *string, const char *data, u64 length) {
+  return string->length == length &&
+         !memcmp(evalStringData(string), data, length);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+EvalString evalStringCreate(const char *data, u64 length);
+EvalString evalStringIntern(const char *data, u64 length);
+char *evalStringAllocate(u64 length, EvalString *out_string);
+
+EvalString evalStringConcat(EvalString *left, EvalString *right);
+EvalString evalStringSlice(EvalString *string, i64 lo, i64 hi);
+
+const char *evalStringData(EvalString *string);
+char evalStringAt(EvalString *string, i64 index);
+i32 evalStringCompare(EvalString *left, EvalString *right);
+u64 evalStringHash(const char *data, u64 length);
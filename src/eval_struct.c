@@ -0,0 +1,97 @@
+#include "eval_struct.h"
+
+#include "error.h"
+#include "eval_map.h"
+#include "vector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void evalStructInit(EvalStructType *type, EvalValue *slots);
+
+static u32 struct_type_id = 0;
+
+EvalStructType *evalStructTypeCreate(char *name) {
+  EvalStructType *type = malloc(sizeof(EvalStructType));
+  type->name = name;
+  /* 0 is left for an empty field access cache */
+  type->id = __atomic_add_fetch(&struct_type_id, 1, __ATOMIC_RELAXED);
+  type->fields = vectorCreate(EvalStructField);
+
+  return type;
+}
+
+void evalStructTypeAddField(EvalStructType *type, char *name, u8 field_type,
+                            EvalStructType *struct_type) {
+  if (evalStructFieldSlot(type, name) >= 0) {
+    RAISE("liv: field %s is declared twice in struct %s!", name, type->name);
+  }
+
+  EvalStructField field = {};
+  field.name = name;
+  field.type = field_type;
+  field.struct_type = struct_type;
+
+  vectorPush(type->fields, field);
+}
+
+i64 evalStructFieldSlot(EvalStructType *type, const char *name) {
+  for (u32 i = 0; i < vectorLength(type->fields); ++i) {
+    if (!strcmp(type->fields[i].name, name)) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+u32 evalStructFieldCount(EvalStructType *type) {
+  return vectorLength(type->fields);
+}
+
+EvalStruct evalStructCreate(EvalStructType *type) {
+  EvalStruct structure = {};
+  structure.type = type;
+  structure.slots = malloc(sizeof(EvalValue) * evalStructFieldCount(type));
+
+  evalStructInit(type, structure.slots);
+
+  return structure;
+}
+
+void evalStructCreateMany(EvalStructType *type, EvalValue *out_values,
+                          u64 count) {
+  u32 field_count = evalStructFieldCount(type);
+  EvalValue *slots = malloc(sizeof(EvalValue) * field_count * count);
+
+  for (u64 i = 0; i < count; ++i) {
+    EvalValue *value = &out_values[i];
+    value->type = EVAL_VALUE_TYPE_STRUCT;
+    value->value.structure.type = type;
+    value->value.structure.slots = slots + i * field_count;
+
+    evalStructInit(type, value->value.structure.slots);
+  }
+}
+
+static void evalStructInit(EvalStructType *type, EvalValue *slots) {
+  for (u32 i = 0; i < evalStructFieldCount(type); ++i) {
+    EvalStructField *field = &type->fields[i];
+
+    EvalValue slot = {};
+    slot.type = field->type;
+    switch (field->type) {
+    case EVAL_VALUE_TYPE_ARRAY: {
+      slot.value.array.rank = 1;
+    } break;
+    case EVAL_VALUE_TYPE_MAP: {
+      slot.value.map = evalMapCreate();
+    } break;
+    case EVAL_VALUE_TYPE_STRUCT: {
+      slot.value.structure = evalStructCreate(field->struct_type);
+    } break;
+    };
+
+    slots[i] = slot;
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "defines.h"
+#include "eval_value.h"
+
+EvalStructType *evalStructTypeCreate(char *name);
+void evalStructTypeAddField(EvalStructType *type, char *name, u8 field_type,
+                            EvalStructType *struct_type);
+
+/* slot index of the field, -1 if the struct has no such field */
+i64 evalStructFieldSlot(EvalStructType *type, const char *name);
+u32 evalStructFieldCount(EvalStructType *type);
+
+EvalStruct evalStructCreate(EvalStructType *type);
+/* lays out count instances back to back in one block of slots */
+void evalStructCreateMany(EvalStructType *type, EvalValue *out_values,
+                          u64 count);
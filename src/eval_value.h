@@ -2,6 +2,7 @@
 
 #include "ast_node.h"
 #include "defines.h"
+#include "thread_pool.h"
 
 typedef enum EvalValueType {
   EVAL_VALUE_TYPE_UNKNOWN,
@@ -12,6 +13,13 @@ typedef enum EvalValueType {
   EVAL_VALUE_TYPE_ARRAY,
   EVAL_VALUE_TYPE_IDENT,
   EVAL_VALUE_TYPE_FUN,
+  EVAL_VALUE_TYPE_NATIVE,
+  EVAL_VALUE_TYPE_MAP,
+  EVAL_VALUE_TYPE_STRUCT,
+  EVAL_VALUE_TYPE_STRUCT_TYPE,
+  EVAL_VALUE_TYPE_FUTURE,
+  EVAL_VALUE_TYPE_CHAN,
+  EVAL_VALUE_TYPE_GENERATOR,
 } EvalValueType;
 
 typedef enum EvalPayloadType {
@@ -23,9 +31,54 @@ typedef enum EvalPayloadType {
 
 struct EvalValue;
 struct EvalVariable;
+struct EvalMap;
+struct EvalStructType;
+struct EvalFuture;
+struct EvalChan;
+struct EvalGenerator;
+
+/* builtin or host function, called with already evaluated arguments */
+typedef struct EvalValue (*EvalNativeFun)(struct EvalValue *args, u32 argc);
+
+/* immutable, length-prefixed string storage. data past length is free space
+ * that a concatenation may claim in place */
+typedef struct EvalStringBuffer {
+  u64 length;
+  u64 capacity;
+  char data[];
+} EvalStringBuffer;
+
+/* window into string storage, substrings share the buffer of the source */
+typedef struct EvalString {
+  EvalStringBuffer *buffer;
+  u64 offset;
+  u64 length;
+} EvalString;
+
+/* view into array storage, slices share the elements of the source array.
+ * multi-dimensional arrays are stored row-major in one block, length is the
+ * outer extent and dims holds the rank - 1 inner extents. int, float and char
+ * arrays hold raw i64, f64 and char elements, the others hold EvalValues */
+typedef struct EvalArray {
+  void *elements;
+  u64 offset;
+  u64 length;
+  u64 *dims;
+  u8 rank;
+  u8 element_type;
+} EvalArray;
+
+/* struct instance, fields live in consecutive slots in declaration order.
+ * instances are shared by reference, copies see the same slots */
+typedef struct EvalStruct {
+  struct EvalStructType *type;
+  struct EvalValue *slots;
+} EvalStruct;
 
 typedef struct EvalFunData {
   u8 return_value;
+  /* the body yields, a call returns a generator */
+  b8 generator;
   ASTNode block;
   struct EvalVariable *arguments;
 } EvalFunData;
@@ -34,9 +87,16 @@ typedef union EvalValueData {
   i64 integer;
   f64 floating;
   char character;
-  char *string;
+  EvalString string;
   EvalFunData function;
-  struct EvalValue *array;
+  EvalNativeFun native;
+  EvalArray array;
+  struct EvalMap *map;
+  EvalStruct structure;
+  struct EvalStructType *struct_type;
+  struct EvalFuture *future;
+  struct EvalChan *chan;
+  struct EvalGenerator *generator;
 } EvalValueData;
 
 typedef struct EvalValue {
@@ -49,3 +109,64 @@ typedef struct EvalVariable {
   struct EvalValue value;
   char *identifier;
 } EvalVariable;
+
+/* result of a spawned call, written once by the task that runs it */
+typedef struct EvalFuture {
+  ThreadGroup group;
+  struct EvalValue result;
+} EvalFuture;
+
+typedef struct EvalChanSlot {
+  u64 sequence;
+  struct EvalValue value;
+} EvalChanSlot;
+
+/* bounded channel on a lock-free ring. a slot's sequence says whose turn it
+ * is, so senders and receivers only contend on their own end. the top bit
+ * of tail marks the channel closed. the lock and the condition are used by
+ * threads sleeping on a full or empty ring */
+typedef struct EvalChan {
+  EvalChanSlot *slots;
+  u64 capacity;
+  _Alignas(64) u64 head;
+  _Alignas(64) u64 tail;
+  _Alignas(64) u32 sleepers;
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} EvalChan;
+
+typedef struct EvalMapEntry {
+  struct EvalValue key;
+  struct EvalValue value;
+} EvalMapEntry;
+
+/* open addressing hash map in the swiss table layout. every slot has a
+ * control byte holding 7 bits of the key hash, so a probe scans a group of
+ * control bytes at once and touches entries only on a tag match */
+typedef struct EvalMap {
+  i8 *control;
+  EvalMapEntry *entries;
+  u64 capacity;
+  u64 length;
+  u64 tombstones;
+  /* number of parallel loops that can reach the map, it cannot be changed
+   * while this is not zero */
+  u32 frozen;
+  /* spawned tasks can share the map with their caller */
+  pthread_mutex_t lock;
+} EvalMap;
+
+typedef struct EvalStructField {
+  char *name;
+  u8 type;
+  /* layout of a nested struct field, null otherwise */
+  struct EvalStructType *struct_type;
+} EvalStructField;
+
+/* fixed layout of a struct, a field is addressed by its slot index. the id is
+ * unique per declaration so field accesses can cache the resolved slot */
+typedef struct EvalStructType {
+  char *name;
+  u32 id;
+  EvalStructField *fields;
+} EvalStructType;
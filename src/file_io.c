@@ -1,25 +1,83 @@
 #include "file_io.h"
 
-#include "logger.h"
-
-#include <stdio.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define FILE_READ_CHUNK 65536
+
+b8 fileViewOpen(const char *path, FileView *out_view) {
+  i32 fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  b8 viewed = fileViewRead(fd, out_view);
+  close(fd);
 
-b8 readFile(const char *path, char **buf) {
-  FILE *f = fopen(path, "rb");
-  if (f == 0) {
+  return viewed;
+}
+
+b8 fileViewRead(i32 fd, FileView *out_view) {
+  struct stat info;
+  if (fstat(fd, &info)) {
     return false;
   }
 
-  fseek(f, 0, SEEK_END);
-  long fsize = ftell(f);
-  fseek(f, 0, SEEK_SET);
+  /* the mapping outlives the descriptor. an empty file cannot be mapped
+   * and takes the read path */
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (S_ISREG(info.st_mode) && offset == 0 && info.st_size > 0) {
+    void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      /* the lexer reads it front to back once */
+      madvise(data, info.st_size, MADV_SEQUENTIAL);
 
-  (*buf) = malloc(fsize + 1);
-  fread(*buf, sizeof(char), fsize, f);
-  fclose(f);
+      out_view->data = data;
+      out_view->length = info.st_size;
+      out_view->mapped = true;
 
-  (*buf)[fsize] = EOF;
+      return true;
+    }
+  }
+
+  u64 length = 0;
+  u64 capacity = FILE_READ_CHUNK;
+  char *data = malloc(capacity);
+  for (;;) {
+    if (length == capacity) {
+      capacity *= 2;
+      data = realloc(data, capacity);
+    }
+
+    i64 count = read(fd, data + length, capacity - length);
+    if (count < 0) {
+      free(data);
+      return false;
+    }
+    if (count == 0) {
+      break;
+    }
+    length += count;
+  }
+
+  out_view->data = data;
+  out_view->length = length;
+  out_view->mapped = false;
 
   return true;
+}
+
+void fileViewClose(FileView *view) {
+  if (view->mapped) {
+    munmap((void *)view->data, view->length);
+  } else {
+    free((void *)view->data);
+  }
+
+  view->data = 0;
+  view->length = 0;
+  view->mapped = false;
 }
\ No newline at end of file
@@ -2,4 +2,16 @@
 
 #include "defines.h"
 
-b8 readFile(const char *path, char **buf);
\ No newline at end of file
+/* the bytes of a file, not terminated. a regular file is mapped, so the
+ * page cache backs it and processes reading it share the pages. anything
+ * else, such as a pipe, is read into memory */
+typedef struct FileView {
+  const char *data;
+  u64 length;
+  b8 mapped;
+} FileView;
+
+b8 fileViewOpen(const char *path, FileView *out_view);
+/* views what is left to read from fd, which stays open */
+b8 fileViewRead(i32 fd, FileView *out_view);
+void fileViewClose(FileView *view);
\ No newline at end of file
@@ -8,4 +8,5 @@ typedef union InterpreterValue {
   char character;
   char *string;
   char *identifier;
+  struct ParserBody *body;
 } InterpreterValue;
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "lexer.h"
 
+#include "error.h"
 #include "logger.h"
+#include "simd.h"
 #include "vector.h"
 
 #include <ctype.h>
@@ -10,47 +12,162 @@
 
 #define IDENTIFIER_MAX_LENGTH 255
 #define MAX_TEXT_LENGTH 2048
+#define TOKEN_SOURCE_BYTES 8
+/* the guess is capped, the vector grows past it */
+#define TOKEN_RESERVE_MAX (1 << 20)
+
+#define KEYWORD_MIN_LENGTH 2
+#define KEYWORD_MAX_LENGTH 8
+/* perfect over the keywords, each lands in a slot of its own. a new keyword
+ * may need new constants, lexerKeywordsInit checks it does not */
+#define KEYWORD_SLOTS 64
+#define KEYWORD_HASH(first, last, length)                                     \
+  (((first) + (last) * 13 + ((length) << 3)) & (KEYWORD_SLOTS - 1))
+#define KEYWORD(name, type) {name, sizeof(name) - 1, type}
+
+typedef struct Keyword {
+  const char *name;
+  u8 length;
+  u8 type;
+} Keyword;
+
+static const Keyword keyword_list[] = {
+    KEYWORD("import", TOKEN_TYPE_IMPORT),
+    KEYWORD("var", TOKEN_TYPE_VAR),
+    KEYWORD("fun", TOKEN_TYPE_FUN),
+    KEYWORD("struct", TOKEN_TYPE_STRUCT),
+    KEYWORD("if", TOKEN_TYPE_IF),
+    KEYWORD("else", TOKEN_TYPE_ELSE),
+    KEYWORD("while", TOKEN_TYPE_WHILE),
+    KEYWORD("for", TOKEN_TYPE_FOR),
+    KEYWORD("pfor", TOKEN_TYPE_PFOR),
+    KEYWORD("spawn", TOKEN_TYPE_SPAWN),
+    KEYWORD("await", TOKEN_TYPE_AWAIT),
+    KEYWORD("yield", TOKEN_TYPE_YIELD),
+    KEYWORD("in", TOKEN_TYPE_IN),
+    KEYWORD("return", TOKEN_TYPE_RETURN),
+    KEYWORD("break", TOKEN_TYPE_BREAK),
+    KEYWORD("continue", TOKEN_TYPE_CONTINUE),
+    KEYWORD("void", TOKEN_TYPE_VOID),
+    KEYWORD("int", TOKEN_TYPE_INT),
+    KEYWORD("float", TOKEN_TYPE_FLOAT),
+    KEYWORD("char", TOKEN_TYPE_CHAR),
+    KEYWORD("string", TOKEN_TYPE_STRING),
+    KEYWORD("print", TOKEN_TYPE_PRINT),
+};
+
+/* keyword_list by hash, an empty slot has length 0 */
+static Keyword keywords[KEYWORD_SLOTS];
 
 static Token lexerReadToken(Lexer *lexer);
 static f64 lexerReadNumber(Lexer *lexer, char c, b8 *has_decimal);
 static char lexerReadChar(Lexer *lexer);
-static char *lexerReadString(Lexer *lexer);
-static char *lexerReadIdentifier(Lexer *lexer, char c);
-static TokenType lexerReadKeyword(Lexer *lexer, const char *s);
+static void lexerReadString(Lexer *lexer);
+static void lexerReadIdentifier(Lexer *lexer);
+static TokenType lexerReadKeyword(const char *s, u64 length);
+static void lexerKeywordsInit();
 
 static char lexerNextLetter(Lexer *lexer);
 static char lexerNextLetterSkip(Lexer *lexer);
 static void lexerSkipLine(Lexer *lexer);
+static void lexerSkipBlock(Lexer *lexer);
+static u64 lexerSkipUntil(Lexer *lexer, char a, char b);
+static b8 lexerIsBlank(char c);
+static b8 lexerIsIdent(char c);
 
 static char lexerCharPos(Lexer *lexer, char *s, char c);
 
-void lexerCreate(const char *source, Lexer *out_lexer) {
+void lexerCreate(const char *source, u64 length, Lexer *out_lexer) {
   out_lexer->source = source;
+  out_lexer->length = length;
   out_lexer->index = 0;
-  out_lexer->line = 0;
+  out_lexer->line = 1;
 }
 
 void lexerDestroy(Lexer *lexer) {
   lexer->source = 0;
+  lexer->length = 0;
   lexer->index = 0;
   lexer->line = 0;
 }
 
 Token *lexerScan(Lexer *lexer) {
-  Token *tokens = vectorCreate(Token);
+  /* sized by a guess, so a big file is not regrown from the default */
+  u64 estimate = (lexer->length - lexer->index) / TOKEN_SOURCE_BYTES + 1;
+  if (estimate > TOKEN_RESERVE_MAX) {
+    estimate = TOKEN_RESERVE_MAX;
+  }
+  Token *tokens = vectorReserve(Token, estimate);
   Token token = {};
 
   do {
-    token = lexerReadToken(lexer);
+    token = lexerNext(lexer);
     vectorPush(tokens, token);
   } while (token.type != TOKEN_TYPE_EOF);
 
   return tokens;
 }
 
+Token lexerNext(Lexer *lexer) {
+  Token token = lexerReadToken(lexer);
+  token.line = lexer->line;
+
+  return token;
+}
+
+InterpreterValue lexerTokenValue(const char *source, Token *token) {
+  InterpreterValue value = {};
+
+  /* the token was checked when it was lexed, this only reads it again */
+  Lexer lexer;
+  lexerCreate(source + tokenOffset(token), token->length, &lexer);
+  lexer.line = token->line;
+
+  if (token->type == TOKEN_TYPE_CHARLIT) {
+    value.character = lexerReadChar(&lexer);
+    return value;
+  }
+
+  char c = lexerNextLetter(&lexer);
+  b8 negative = c == '-';
+  if (negative) {
+    c = lexerNextLetter(&lexer);
+  }
+
+  b8 has_decimal;
+  f64 val = lexerReadNumber(&lexer, c, &has_decimal);
+  if (token->type == TOKEN_TYPE_FLOATLIT) {
+    value.floating = negative ? -val : val;
+  } else {
+    value.integer = negative ? -(i64)val : (i64)val;
+  }
+
+  return value;
+}
+
+void lexerTokenString(const char *source, Token *token, char *out) {
+  const char *text = source + tokenOffset(token);
+  if (token->type == TOKEN_TYPE_IDENT || !memchr(text, '\\', token->length)) {
+    memcpy(out, text, token->length);
+    out[token->length] = '\0';
+    return;
+  }
+
+  Lexer lexer;
+  lexerCreate(text, token->length, &lexer);
+  lexer.line = token->line;
+
+  u64 i = 0;
+  while (lexer.index < lexer.length) {
+    out[i++] = lexerReadChar(&lexer);
+  }
+  out[i] = '\0';
+}
+
 static Token lexerReadToken(Lexer *lexer) {
   Token token = {};
   char c = lexerNextLetterSkip(lexer);
+  u64 begin = lexer->index - 1;
 
   switch (c) {
   case EOF: {
@@ -72,14 +189,8 @@ static Token lexerReadToken(Lexer *lexer) {
       token.type = TOKEN_TYPE_DEC;
     } else if (isdigit(c)) {
       b8 has_decimal;
-      f64 val = lexerReadNumber(lexer, c, &has_decimal);
-      if (has_decimal) {
-        token.type = TOKEN_TYPE_FLOATLIT;
-        token.value.floating = -val;
-      } else {
-        token.type = TOKEN_TYPE_INTLIT;
-        token.value.integer = -(i64)val;
-      }
+      lexerReadNumber(lexer, c, &has_decimal);
+      token.type = has_decimal ? TOKEN_TYPE_FLOATLIT : TOKEN_TYPE_INTLIT;
     } else {
       lexer->index--;
       token.type = TOKEN_TYPE_MINUS;
@@ -89,28 +200,7 @@ static Token lexerReadToken(Lexer *lexer) {
     token.type = TOKEN_TYPE_STAR;
   } break;
   case '/': {
-    c = lexerNextLetter(lexer);
-    if (c == '/') {
-      lexerSkipLine(lexer);
-      return lexerReadToken(lexer);
-    } else if (c == '*') {
-      while (1) {
-        c = lexerNextLetter(lexer);
-        if (c == EOF) {
-          FATAL("liv: unexpected end of file!");
-        }
-        if (c == '*') {
-          if ((c = lexerNextLetter(lexer)) == '/') {
-            return lexerReadToken(lexer);
-          } else {
-            lexer->index--;
-          }
-        }
-      }
-    } else {
-      lexer->index--;
-      token.type = TOKEN_TYPE_SLASH;
-    }
+    token.type = TOKEN_TYPE_SLASH;
   } break;
   case '=': {
     if ((c = lexerNextLetter(lexer)) == '=') {
@@ -148,23 +238,26 @@ static Token lexerReadToken(Lexer *lexer) {
     if ((c = lexerNextLetter(lexer)) == '&') {
       token.type = TOKEN_TYPE_AND;
     } else {
-      FATAL("liv: invalid token at line %d!", lexer->line);
-      exit(1);
+      RAISE_AT(lexer->line, "liv: invalid token!");
     }
   } break;
   case '|': {
     if ((c = lexerNextLetter(lexer)) == '|') {
       token.type = TOKEN_TYPE_OR;
     } else {
-      FATAL("liv: invalid token at line %d!", lexer->line);
-      exit(1);
+      RAISE_AT(lexer->line, "liv: invalid token!");
     }
   } break;
   case ';': {
     token.type = TOKEN_TYPE_SEMI;
   } break;
   case '.': {
-    token.type = TOKEN_TYPE_DOT;
+    if ((c = lexerNextLetter(lexer)) == '.') {
+      token.type = TOKEN_TYPE_DOTDOT;
+    } else {
+      lexer->index--;
+      token.type = TOKEN_TYPE_DOT;
+    }
   } break;
   case ':': {
     token.type = TOKEN_TYPE_COLON;
@@ -192,48 +285,54 @@ static Token lexerReadToken(Lexer *lexer) {
   } break;
   case '\'': {
     token.type = TOKEN_TYPE_CHARLIT;
-    token.value.character = lexerReadChar(lexer);
+    lexerReadChar(lexer);
 
     if (lexerNextLetter(lexer) != '\'') {
-      FATAL("liv: exprected '\\'' at end of char literal!");
+      RAISE_AT(lexer->line, "liv: exprected '\\'' at end of char literal!");
     }
   } break;
   case '"': {
     token.type = TOKEN_TYPE_STRLIT;
-    token.value.string = lexerReadString(lexer);
+    lexerReadString(lexer);
   } break;
   default: {
     if (isdigit(c)) {
       b8 has_decimal = false;
-      f64 val = lexerReadNumber(lexer, c, &has_decimal);
-      if (has_decimal) {
-        token.type = TOKEN_TYPE_FLOATLIT;
-        token.value.floating = val;
-      } else {
-        token.type = TOKEN_TYPE_INTLIT;
-        token.value.integer = (i64)val;
-      }
+      lexerReadNumber(lexer, c, &has_decimal);
+      token.type = has_decimal ? TOKEN_TYPE_FLOATLIT : TOKEN_TYPE_INTLIT;
     } else if (isalpha(c) || c == '_') {
-      TokenType type;
+      lexerReadIdentifier(lexer);
 
-      char *buf = lexerReadIdentifier(lexer, c);
-
-      if ((type = lexerReadKeyword(lexer, buf)) != TOKEN_TYPE_NONE) {
-        token.type = type;
-        free(buf);
-        break;
+      token.type = lexerReadKeyword(lexer->source + begin,
+                                    lexer->index - begin);
+      if (token.type == TOKEN_TYPE_NONE) {
+        token.type = TOKEN_TYPE_IDENT;
       }
-
-      token.type = TOKEN_TYPE_IDENT;
-      token.value.identifier = buf;
-      break;
     } else {
-      FATAL("liv: unrecognised character %c on line %d!", c, lexer->line);
-      exit(1);
+      RAISE_AT(lexer->line, "liv: unrecognised character %c!", c);
     }
   } break;
   };
 
+  /* literals span what is between their quotes */
+  u64 end = lexer->index;
+  if (token.type == TOKEN_TYPE_STRLIT || token.type == TOKEN_TYPE_CHARLIT) {
+    begin++;
+    end--;
+  } else if (token.type == TOKEN_TYPE_EOF) {
+    end = begin;
+  }
+
+  if (end >> 40) {
+    RAISE_AT(lexer->line, "liv: source larger than 1 TB!");
+  }
+  if (end - begin > UINT16_MAX) {
+    RAISE_AT(lexer->line, "liv: token longer than 64 KB!");
+  }
+  token.offset = begin;
+  token.offset_high = begin >> 32;
+  token.length = end - begin;
+
   return token;
 }
 
@@ -247,11 +346,16 @@ static f64 lexerReadNumber(Lexer *lexer, char c, b8 *has_decimal) {
   *has_decimal = false;
 
   while ((k = lexerCharPos(lexer, "0123456789.", c)) >= 0) {
+    /* 0..n is a range, not a float */
+    if (c == '.' && lexer->index < lexer->length &&
+        lexer->source[lexer->index] == '.') {
+      break;
+    }
+
     if (c == '.') {
       *has_decimal = true;
       if (decimal_pos >= 0) {
-        FATAL("liv: invalid float value");
-        exit(1);
+        RAISE_AT(lexer->line, "liv: invalid float value");
       }
 
       decimal_pos = num_digits;
@@ -306,121 +410,104 @@ static char lexerReadChar(Lexer *lexer) {
     case '\'':
       return '\'';
     default:
-      FATAL("liv: unknown escape sequence %c", c);
-      exit(1);
+      RAISE_AT(lexer->line, "liv: unknown escape sequence %c", c);
     }
   }
 
   return c;
 }
 
-static char *lexerReadString(Lexer *lexer) {
-  u32 i = 0;
-  char c = 0;
-  char *buf = malloc(sizeof(char) * MAX_TEXT_LENGTH);
-
-  for (i = 0; i < MAX_TEXT_LENGTH - 1; ++i) {
-    if ((c = lexerReadChar(lexer)) == '"') {
-      buf[i] = '\0';
-
-      return buf;
+/* steps to the closing quote, checking the escapes on the way. the token
+ * is read again for its text */
+static void lexerReadString(Lexer *lexer) {
+  u64 length = 0;
+  for (;;) {
+    length += lexerSkipUntil(lexer, '"', '\\');
+    if (length >= MAX_TEXT_LENGTH - 1) {
+      RAISE_AT(lexer->line, "liv: string literal too long");
     }
-    buf[i] = c;
-  }
 
-  FATAL("liv: string literal too long on line %d", lexer->line);
-  exit(1);
+    char c = lexerNextLetter(lexer);
+    if (c == '"') {
+      return;
+    }
+    if (c == EOF) {
+      RAISE_AT(lexer->line, "liv: unexpected end of file!");
+    }
 
-  return buf;
+    lexer->index--;
+    lexerReadChar(lexer);
+    length++;
+  }
 }
 
-static char *lexerReadIdentifier(Lexer *lexer, char c) {
-  char *buf = malloc(sizeof(char) * MAX_TEXT_LENGTH);
-  u32 i = 0;
+/* the first letter has been read */
+static void lexerReadIdentifier(Lexer *lexer) {
+  u64 length = 1;
+  if (lexer->index < lexer->length &&
+      lexerIsIdent(lexer->source[lexer->index])) {
+    length += simdSpanIdent(lexer->source + lexer->index,
+                            lexer->length - lexer->index);
+  }
+  if (length >= IDENTIFIER_MAX_LENGTH) {
+    RAISE_AT(lexer->line, "liv: identifier too long");
+  }
 
-  while (isalpha(c) || isdigit(c) || c == '_') {
-    if (i == (IDENTIFIER_MAX_LENGTH - 1)) {
-      FATAL("liv: identifier too long on line %d", lexer->line);
-      exit(1);
-    }
+  lexer->index += length - 1;
+}
 
-    buf[i] = c;
-    i++;
-    c = lexerNextLetter(lexer);
+static TokenType lexerReadKeyword(const char *s, u64 length) {
+  if (length < KEYWORD_MIN_LENGTH || length > KEYWORD_MAX_LENGTH) {
+    return TOKEN_TYPE_NONE;
   }
 
-  lexer->index--;
-  buf[i] = '\0';
+  const Keyword *keyword =
+      &keywords[KEYWORD_HASH((u8)s[0], (u8)s[length - 1], length)];
+  if (keyword->length != length || memcmp(keyword->name, s, length)) {
+    return TOKEN_TYPE_NONE;
+  }
 
-  return buf;
+  return keyword->type;
 }
 
-static TokenType lexerReadKeyword(Lexer *lexer, const char *s) {
-  switch (s[0]) {
-  case 'i': {
-    if (!strcmp(s, "int"))
-      return TOKEN_TYPE_INT;
-    if (!strcmp(s, "if"))
-      return TOKEN_TYPE_IF;
-    if (!strcmp(s, "import"))
-      return TOKEN_TYPE_IMPORT;
-  } break;
-  case 'p': {
-    if (!strcmp(s, "print"))
-      return TOKEN_TYPE_PRINT;
-  } break;
-  case 'w': {
-    if (!strcmp(s, "while"))
-      return TOKEN_TYPE_WHILE;
-  } break;
-  case 'f': {
-    if (!strcmp(s, "float"))
-      return TOKEN_TYPE_FLOAT;
-    if (!strcmp(s, "for"))
-      return TOKEN_TYPE_FOR;
-    if (!strcmp(s, "fun")) {
-      return TOKEN_TYPE_FUN;
+/* runs before main. a keyword list the hash does not fit stops every
+ * program, so a clash cannot silently turn a keyword into an identifier */
+__attribute__((constructor)) static void lexerKeywordsInit() {
+  u32 count = sizeof(keyword_list) / sizeof(keyword_list[0]);
+  for (u32 i = 0; i < count; ++i) {
+    const Keyword *keyword = &keyword_list[i];
+    u8 first = keyword->name[0];
+    u8 last = keyword->name[keyword->length - 1];
+    Keyword *slot = &keywords[KEYWORD_HASH(first, last, keyword->length)];
+    if (slot->length) {
+      FATAL("liv: keywords %s and %s hash to the same slot!", slot->name,
+            keyword->name);
+      exit(1);
     }
-  } break;
-  case 's': {
-    if (!strcmp(s, "string"))
-      return TOKEN_TYPE_STRING;
-  } break;
-  case 'v': {
-    if (!strcmp(s, "var"))
-      return TOKEN_TYPE_VAR;
-    if (!strcmp(s, "void"))
-      return TOKEN_TYPE_VOID;
-  } break;
-  case 'r': {
-    if (!strcmp(s, "return"))
-      return TOKEN_TYPE_RETURN;
-  } break;
-  case 'b': {
-    if (!strcmp(s, "break"))
-      return TOKEN_TYPE_BREAK;
-  } break;
-  case 'c': {
-    if (!strcmp(s, "char"))
-      return TOKEN_TYPE_CHAR;
-    if (!strcmp(s, "continue"))
-      return TOKEN_TYPE_CONTINUE;
-  } break;
-  case 'e': {
-    if (!strcmp(s, "else"))
-      return TOKEN_TYPE_ELSE;
-  } break;
-  };
 
-  return TOKEN_TYPE_NONE;
+    *slot = *keyword;
+  }
+
+  for (u32 i = 0; i < count; ++i) {
+    const Keyword *keyword = &keyword_list[i];
+    if (lexerReadKeyword(keyword->name, keyword->length) != keyword->type) {
+      FATAL("liv: keyword %s is not recognised!", keyword->name);
+      exit(1);
+    }
+  }
 }
 
 static char lexerNextLetter(Lexer *lexer) {
   char c = 0;
 
-  if (lexer->index >= strlen(lexer->source)) {
-    FATAL("liv: lexer source index out of range");
-    exit(1);
+  /* one EOF past the end, which may be stepped back over */
+  if (lexer->index >= lexer->length) {
+    if (lexer->index > lexer->length) {
+      RAISE_AT(lexer->line, "liv: lexer source index out of range");
+    }
+
+    lexer->index++;
+    return EOF;
   }
 
   c = lexer->source[lexer->index++];
@@ -430,22 +517,83 @@ static char lexerNextLetter(Lexer *lexer) {
   return c;
 }
 
+/* the first letter past whitespace and comments */
 static char lexerNextLetterSkip(Lexer *lexer) {
-  char c = lexerNextLetter(lexer);
+  for (;;) {
+    char c = lexerNextLetter(lexer);
+    if (lexerIsBlank(c)) {
+      /* most runs are a single blank, longer ones are scanned */
+      if (lexer->index < lexer->length &&
+          lexerIsBlank(lexer->source[lexer->index])) {
+        u64 lines;
+        lexer->index += simdSpanSpace(lexer->source + lexer->index,
+                                      lexer->length - lexer->index, &lines);
+        lexer->line += lines;
+      }
+      continue;
+    }
 
-  while (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f')
-    c = lexerNextLetter(lexer);
+    if (c != '/' || lexer->index >= lexer->length) {
+      return c;
+    }
 
-  return c;
+    switch (lexer->source[lexer->index]) {
+    case '/':
+      lexerSkipLine(lexer);
+      break;
+    case '*':
+      lexer->index++;
+      lexerSkipBlock(lexer);
+      break;
+    default:
+      return c;
+    }
+  }
 }
 
+/* a comment may end the source without a newline */
 static void lexerSkipLine(Lexer *lexer) {
-  i32 line = lexer->line;
-
-  while (line == lexer->line)
+  lexerSkipUntil(lexer, '\n', '\n');
+  if (lexer->index < lexer->length) {
     lexerNextLetter(lexer);
+  }
 }
 
+static void lexerSkipBlock(Lexer *lexer) {
+  for (;;) {
+    lexerSkipUntil(lexer, '*', '*');
+    if (lexerNextLetter(lexer) == EOF) {
+      RAISE_AT(lexer->line, "liv: unexpected end of file!");
+    }
+
+    if (lexer->index < lexer->length && lexer->source[lexer->index] == '/') {
+      lexer->index++;
+      return;
+    }
+  }
+}
+
+/* steps to the first a or b, or to the end, and returns how far */
+static u64 lexerSkipUntil(Lexer *lexer, char a, char b) {
+  if (lexer->index >= lexer->length) {
+    return 0;
+  }
+
+  u64 lines;
+  u64 run = simdSpanUntil(lexer->source + lexer->index,
+                          lexer->length - lexer->index, a, b, &lines);
+  lexer->index += run;
+  lexer->line += lines;
+
+  return run;
+}
+
+static b8 lexerIsBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static b8 lexerIsIdent(char c) { return isalnum(c) || c == '_'; }
+
 static char lexerCharPos(Lexer *lexer, char *s, char c) {
   char *p;
 
@@ -1,15 +1,26 @@
 #pragma once
 
 #include "defines.h"
+#include "interpreter_value.h"
 #include "token.h"
 
+/* the source needs no terminator, reading past its length gives EOF */
 typedef struct Lexer {
   const char *source;
+  u64 length;
   i64 index;
   u64 line;
 } Lexer;
 
-void lexerCreate(const char *source, Lexer *out_lexer);
+void lexerCreate(const char *source, u64 length, Lexer *out_lexer);
 void lexerDestroy(Lexer *lexer);
 
-Token *lexerScan(Lexer *lexer);
\ No newline at end of file
+Token *lexerScan(Lexer *lexer);
+/* one token at a time, EOF once the source is exhausted */
+Token lexerNext(Lexer *lexer);
+
+/* value of a number or char literal lexed from source */
+InterpreterValue lexerTokenValue(const char *source, Token *token);
+/* text of an identifier or string literal lexed from source, escapes
+ * resolved. out holds at least length + 1 bytes and is terminated */
+void lexerTokenString(const char *source, Token *token, char *out);
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "liv.h"
+
+#include "ast_cache.h"
+#include "environment.h"
+#include "eval.h"
+#include "eval_array.h"
+#include "eval_string.h"
+#include "file_io.h"
+#include "lexer.h"
+#include "parser.h"
+#include "thread_pool.h"
+#include "vector.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* a parsed module, with everything its functions may still point into. a
+ * tree loaded from the cache points into the cache instead of the parser's
+ * strings, its bodies into the source */
+struct LivProgram {
+  FileView source;
+  Token *tokens;
+  Parser parser;
+  ASTNode root;
+  ASTCache cache;
+};
+
+struct LivVM {
+  Environment global_env;
+  /* programs loaded through livLoad, owned by the vm */
+  LivProgram **programs;
+  /* names bound by the host, the scope does not own its identifiers */
+  char **names;
+  Error error;
+};
+
+static LivProgram *livProgramParse(FileView *source, const char *path,
+                                   Error *out_error);
+static b8 livFail(LivVM *vm, Error *error);
+static char *livName(LivVM *vm, const char *name);
+
+LivVM *livCreate() {
+  LivVM *vm = malloc(sizeof(LivVM));
+  environmentCreate(0, &vm->global_env);
+  vm->programs = vectorCreate(LivProgram *);
+  vm->names = vectorCreate(char *);
+  vm->error.message[0] = 0;
+  vm->error.line = 0;
+
+  return vm;
+}
+
+void livDestroy(LivVM *vm) {
+  /* spawned tasks may still run on the programs */
+  threadPoolJoin();
+
+  environmentDestroy(&vm->global_env);
+
+  for (u32 i = 0; i < vectorLength(vm->programs); ++i) {
+    livProgramDestroy(vm->programs[i]);
+  }
+  vectorDestroy(vm->programs);
+
+  for (u32 i = 0; i < vectorLength(vm->names); ++i) {
+    free(vm->names[i]);
+  }
+  vectorDestroy(vm->names);
+
+  free(vm);
+}
+
+LivProgram *livParse(const char *source, Error *out_error) {
+  FileView view = {};
+  view.length = strlen(source);
+  view.data = memcpy(malloc(view.length + 1), source, view.length);
+
+  return livProgramParse(&view, 0, out_error);
+}
+
+LivProgram *livParseFile(const char *path, Error *out_error) {
+  FileView source;
+  if (!fileViewOpen(path, &source)) {
+    out_error->line = 0;
+    snprintf(out_error->message, ERROR_MESSAGE_LENGTH,
+             "liv: failed to read a file %s!", path);
+    return 0;
+  }
+
+  char cache_path[PATH_MAX];
+  if (!ASTCachePath(path, cache_path, sizeof(cache_path))) {
+    return livProgramParse(&source, path, out_error);
+  }
+
+  LivProgram *program = calloc(1, sizeof(LivProgram));
+  if (ASTCacheLoad(cache_path, source.data, source.length, &program->root,
+                   &program->cache)) {
+    program->source = source;
+    parserCreate(0, 0, &program->parser);
+
+    return program;
+  }
+  free(program);
+
+  program = livProgramParse(&source, path, out_error);
+  if (program) {
+    ASTCacheStore(cache_path, program->source.data, program->source.length,
+                  &program->root, program->parser.modules->paths);
+  }
+
+  return program;
+}
+
+void livProgramDestroy(LivProgram *program) {
+  ASTNodeDestroy(&program->root);
+  parserDestroy(&program->parser);
+  if (program->tokens) {
+    vectorDestroy(program->tokens);
+  }
+  if (program->cache.mapping) {
+    ASTCacheRelease(&program->cache);
+  }
+  fileViewClose(&program->source);
+  free(program);
+}
+
+char **livProgramImports(LivProgram *program) {
+  if (program->cache.mapping) {
+    return program->cache.paths;
+  }
+
+  return program->parser.modules->paths;
+}
+
+b8 livRun(LivVM *vm, LivProgram *program) {
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    return livFail(vm, &trap.error);
+  }
+
+  eval(&program->root, &vm->global_env);
+  errorTrapPop(&trap);
+
+  return true;
+}
+
+b8 livLoad(LivVM *vm, const char *source) {
+  Error error;
+  LivProgram *program = livParse(source, &error);
+  if (!program) {
+    return livFail(vm, &error);
+  }
+
+  vectorPush(vm->programs, program);
+
+  return livRun(vm, program);
+}
+
+b8 livLoadFile(LivVM *vm, const char *path) {
+  Error error;
+  LivProgram *program = livParseFile(path, &error);
+  if (!program) {
+    return livFail(vm, &error);
+  }
+
+  vectorPush(vm->programs, program);
+
+  return livRun(vm, program);
+}
+
+b8 livLoadStream(LivVM *vm, const char *path) {
+  FileView source;
+  if (!fileViewOpen(path, &source)) {
+    Error error = {};
+    snprintf(error.message, ERROR_MESSAGE_LENGTH,
+             "liv: failed to read a file %s!", path);
+    return livFail(vm, &error);
+  }
+
+  /* what the parser keeps lives as long as the vm */
+  LivProgram *program = calloc(1, sizeof(LivProgram));
+  program->source = source;
+  parserCreateStream(source.data, source.length, path, &program->parser);
+  vectorPush(vm->programs, program);
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    return livFail(vm, &trap.error);
+  }
+
+  ASTNode statement;
+  while (parserNextStatement(&program->parser, &statement)) {
+    errorLocate(statement.line);
+    eval(&statement, &vm->global_env);
+    parserStatementRelease(&program->parser, &statement);
+  }
+
+  /* spawned tasks nobody awaited, as at the end of a program */
+  threadPoolJoin();
+  errorTrapPop(&trap);
+
+  return true;
+}
+
+b8 livCall(LivVM *vm, const char *name, LivValue *args, u32 argc,
+           LivValue *out_result) {
+  Error error = {};
+  EvalValue function = {};
+  if (!environmentSearch(&vm->global_env, name, &function)) {
+    snprintf(error.message, ERROR_MESSAGE_LENGTH, "liv: unbound symbol %s",
+             name);
+    return livFail(vm, &error);
+  }
+
+  if (function.type != EVAL_VALUE_TYPE_FUN &&
+      function.type != EVAL_VALUE_TYPE_NATIVE) {
+    snprintf(error.message, ERROR_MESSAGE_LENGTH, "liv: %s is not callable!",
+             name);
+    return livFail(vm, &error);
+  }
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    return livFail(vm, &trap.error);
+  }
+
+  EvalValue result = evalApply(name, &function, args, argc, &vm->global_env);
+  errorTrapPop(&trap);
+
+  if (out_result) {
+    *out_result = result;
+  }
+
+  return true;
+}
+
+b8 livRegister(LivVM *vm, const char *name, LivNativeFun function) {
+  EvalValue value = {};
+  value.type = EVAL_VALUE_TYPE_NATIVE;
+  value.value.native = function;
+
+  return environmentEmplace(&vm->global_env, livName(vm, name), value);
+}
+
+b8 livGet(LivVM *vm, const char *name, LivValue *out_value) {
+  return environmentSearch(&vm->global_env, name, out_value);
+}
+
+void livSet(LivVM *vm, const char *name, LivValue value) {
+  if (!environmentSet(&vm->global_env, name, value)) {
+    environmentEmplace(&vm->global_env, livName(vm, name), value);
+  }
+}
+
+const Error *livError(LivVM *vm) { return &vm->error; }
+
+LivValue livInt(i64 value) {
+  LivValue result = {};
+  result.type = EVAL_VALUE_TYPE_INT;
+  result.value.integer = value;
+
+  return result;
+}
+
+LivValue livFloat(f64 value) {
+  LivValue result = {};
+  result.type = EVAL_VALUE_TYPE_FLOAT;
+  result.value.floating = value;
+
+  return result;
+}
+
+LivValue livString(const char *data, u64 length) {
+  LivValue result = {};
+  result.type = EVAL_VALUE_TYPE_STRING;
+  result.value.string = evalStringCreate(data, length);
+
+  return result;
+}
+
+LivValue livArray(void *data, u64 length, u8 element_type) {
+  LivValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array.elements = data;
+  result.value.array.offset = 0;
+  result.value.array.length = length;
+  result.value.array.dims = 0;
+  result.value.array.rank = 1;
+  result.value.array.element_type = element_type;
+
+  return result;
+}
+
+LivValue livStringArray(char **strings, u32 count) {
+  u64 extent = count;
+
+  LivValue result = {};
+  result.type = EVAL_VALUE_TYPE_ARRAY;
+  result.value.array = evalArrayCreate(&extent, 1, EVAL_VALUE_TYPE_STRING);
+  for (u32 i = 0; i < count; ++i) {
+    LivValue string = livString(strings[i], strlen(strings[i]));
+    evalArrayStore(&result.value.array, i, &string);
+  }
+
+  return result;
+}
+
+void *livArrayData(LivValue *value, u64 *out_length) {
+  if (value->type != EVAL_VALUE_TYPE_ARRAY) {
+    return 0;
+  }
+
+  if (out_length) {
+    *out_length = value->value.array.length;
+  }
+
+  return evalArrayData(&value->value.array);
+}
+
+/* takes ownership of source, it is closed if the parse fails. path locates
+ * the imports, null for a source string */
+static LivProgram *livProgramParse(FileView *source, const char *path,
+                                   Error *out_error) {
+  /* filled in place, so it is intact after a jump back */
+  LivProgram *program = calloc(1, sizeof(LivProgram));
+  program->source = *source;
+  parserCreate(0, path, &program->parser);
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    if (program->tokens) {
+      vectorDestroy(program->tokens);
+    }
+    parserDestroy(&program->parser);
+    fileViewClose(&program->source);
+    free(program);
+    *out_error = trap.error;
+
+    return 0;
+  }
+
+  Lexer lexer;
+  lexerCreate(program->source.data, program->source.length, &lexer);
+  program->tokens = lexerScan(&lexer);
+  lexerDestroy(&lexer);
+
+  program->parser.source = program->source.data;
+  program->parser.tokens = program->tokens;
+  program->root = parserBuildAST(&program->parser);
+
+  errorTrapPop(&trap);
+
+  return program;
+}
+
+/* the error unwound past tasks the script spawned, they are finished before
+ * the host gets control back */
+static b8 livFail(LivVM *vm, Error *error) {
+  vm->error = *error;
+  threadPoolJoin();
+
+  return false;
+}
+
+static char *livName(LivVM *vm, const char *name) {
+  char *copy = strdup(name);
+  vectorPush(vm->names, copy);
+
+  return copy;
+}
\ No newline at end of file
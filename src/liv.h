@@ -0,0 +1,68 @@
+#pragma once
+
+#include "defines.h"
+#include "error.h"
+#include "eval_value.h"
+
+/* embedding interface. a vm holds a global scope and every module loaded
+ * into it, so functions defined by a module can be called until the vm is
+ * destroyed. a script error unwinds back to the host: the call returns
+ * false, livError describes it and the vm stays usable */
+typedef struct LivVM LivVM;
+/* a parsed module. it can be run in any number of vms and must outlive
+ * every vm it ran in */
+typedef struct LivProgram LivProgram;
+
+/* values cross the boundary in the interpreter's own representation */
+typedef EvalValue LivValue;
+typedef EvalNativeFun LivNativeFun;
+
+LivVM *livCreate();
+void livDestroy(LivVM *vm);
+
+/* lexes and parses source, then runs its top level in the global scope.
+ * the vm keeps its own copy of the source. a module that fails to parse is
+ * dropped, one that fails while running keeps what it has bound so far */
+b8 livLoad(LivVM *vm, const char *source);
+b8 livLoadFile(LivVM *vm, const char *path);
+/* runs each top-level statement as soon as it is parsed and frees it once
+ * nothing refers to it, for scripts too big to hold parsed */
+b8 livLoadStream(LivVM *vm, const char *path);
+
+/* parsing and running apart, null and out_error on a parse error */
+LivProgram *livParse(const char *source, Error *out_error);
+LivProgram *livParseFile(const char *path, Error *out_error);
+void livProgramDestroy(LivProgram *program);
+/* canonical paths of the files the program imports, nested imports
+ * included. owned by the program */
+char **livProgramImports(LivProgram *program);
+b8 livRun(LivVM *vm, LivProgram *program);
+
+/* calls a global function, script or native, with evaluated arguments.
+ * also false if name is unbound or not callable */
+b8 livCall(LivVM *vm, const char *name, LivValue *args, u32 argc,
+           LivValue *out_result);
+
+/* binds a host function in the global scope. script definitions loaded
+ * later cannot rebind it, it shadows a builtin of the same name */
+b8 livRegister(LivVM *vm, const char *name, LivNativeFun function);
+
+/* reads or binds a global variable */
+b8 livGet(LivVM *vm, const char *name, LivValue *out_value);
+void livSet(LivVM *vm, const char *name, LivValue value);
+
+/* last error of a load or call that returned false */
+const Error *livError(LivVM *vm);
+
+LivValue livInt(i64 value);
+LivValue livFloat(f64 value);
+LivValue livString(const char *data, u64 length);
+/* one-dimensional array over host memory, nothing is copied. element_type
+ * is EVAL_VALUE_TYPE_INT, FLOAT or CHAR for i64, f64 or char elements, and
+ * the memory must outlive every use of the array by scripts */
+LivValue livArray(void *data, u64 length, u8 element_type);
+/* array of string copies */
+LivValue livStringArray(char **strings, u32 count);
+
+/* first element and length of an array value, null for other values */
+void *livArrayData(LivValue *value, u64 *out_length);
\ No newline at end of file
@@ -1,52 +1,104 @@
-#include "eval.h"
 #include "file_io.h"
-#include "lexer.h"
+#include "liv.h"
 #include "logger.h"
-#include "parser.h"
-#include "vector.h"
+#include "server.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+static i32 mainRun(const char *script, b8 stream, u32 argc, char **argv);
+static b8 mainLoadStdin(LivVM *vm);
+static void mainUsage();
+
+/* liv script.liv [args...]
+ * liv --stream script.liv [args...]
+ * liv --serve socket
+ * liv --connect socket script.liv|- [args...]
+ *
+ * --connect runs the script locally when no server is listening */
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    FATAL("liv: no input file given!");
-    exit(1);
+  if (argc < 2) {
+    mainUsage();
   }
 
-  char *source;
-  if (!readFile(argv[1], &source)) {
-    FATAL("liv: failed to read a file %s!", argv[1]);
-    exit(1);
+  if (!strcmp(argv[1], "--serve")) {
+    if (argc != 3) {
+      mainUsage();
+    }
+
+    if (!serverRun(argv[2])) {
+      FATAL("liv: failed to listen on %s!", argv[2]);
+      exit(1);
+    }
+
+    return 0;
   }
 
-  Lexer lexer;
-  lexerCreate(source, &lexer);
+  if (!strcmp(argv[1], "--connect")) {
+    if (argc < 4) {
+      mainUsage();
+    }
+
+    i32 status;
+    if (serverConnect(argv[2], argv[3], argc - 4, argv + 4, &status)) {
+      return status;
+    }
+
+    return mainRun(argv[3], false, argc - 4, argv + 4);
+  }
 
-  Token *tokens = lexerScan(&lexer);
+  if (!strcmp(argv[1], "--stream")) {
+    if (argc < 3) {
+      mainUsage();
+    }
 
-  Parser parser;
-  parserCreate(tokens, &parser);
+    return mainRun(argv[2], true, argc - 3, argv + 3);
+  }
 
-  ASTNode root = parserBuildAST(&parser);
+  return mainRun(argv[1], false, argc - 2, argv + 2);
+}
 
-  Environment global_env;
-  environmentCreate(0, &global_env);
+static i32 mainRun(const char *script, b8 stream, u32 argc, char **argv) {
+  LivVM *vm = livCreate();
+  livSet(vm, "args", livStringArray(argv, argc));
 
-  eval(&root, &global_env);
+  b8 loaded = false;
+  if (!strcmp(script, "-")) {
+    loaded = mainLoadStdin(vm);
+  } else {
+    loaded = stream ? livLoadStream(vm, script) : livLoadFile(vm, script);
+  }
+  if (!loaded) {
+    errorLog(livError(vm));
+    exit(1);
+  }
 
-  environmentDestroy(&global_env);
+  livDestroy(vm);
 
-  ASTNodeDestroy(&root);
-  parserDestroy(&parser);
+  return 0;
+}
 
-  for (u32 i = 0; i < vectorLength(tokens); ++i) {
-    tokenDestroy(&tokens[i]);
+/* the source sent by --connect socket - when no server is listening */
+static b8 mainLoadStdin(LivVM *vm) {
+  FileView view;
+  if (!fileViewRead(STDIN_FILENO, &view)) {
+    FATAL("liv: failed to read the script from stdin!");
+    exit(1);
   }
 
-  lexerDestroy(&lexer);
-  vectorDestroy(tokens);
+  char *source = malloc(view.length + 1);
+  memcpy(source, view.data, view.length);
+  source[view.length] = 0;
+  fileViewClose(&view);
 
+  b8 loaded = livLoad(vm, source);
   free(source);
 
-  return 0;
+  return loaded;
+}
+
+static void mainUsage() {
+  FATAL("liv: no input file given!");
+  exit(1);
 }
\ No newline at end of file
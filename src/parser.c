@@ -1,17 +1,25 @@
 #include "parser.h"
 
+#include "error.h"
 #include "file_io.h"
 #include "lexer.h"
-#include "logger.h"
 #include "token.h"
 #include "vector.h"
 
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 static ASTNode parserMakeNode(Parser *parser, ASTNodeType type,
                               ASTNode *children, InterpreterValue value);
+static u32 parserLine(Parser *parser);
+static void parserFill(Parser *parser, u64 index);
+static void parserRetention(ASTNode *node, b8 *out_tree, b8 *out_names);
 
 static Token *parserToken(Parser *parser);
+static InterpreterValue parserValue(Parser *parser, Token *token);
+static char *parserString(Parser *parser, Token *token);
 static void parserNextToken(Parser *parser);
 static void parserPrevToken(Parser *parser);
 static ASTNodeType parserArithop(Parser *parser, TokenType type);
@@ -29,9 +37,11 @@ static ASTNode parserPrefix(Parser *parser);
 static ASTNode parserPostfix(Parser *parser);
 static ASTNode parserLiteral(Parser *parser);
 static ASTNode parserArrayAccess(Parser *parser);
+static ASTNode parserFieldAccess(Parser *parser, ASTNode object);
 static ASTNode parserFunccall(Parser *parser);
 static ASTNode parserBinexpr(Parser *parser, i32 pr);
 static ASTNode *parserGlobalStatements(Parser *parser);
+static ASTNode parserGlobalStatement(Parser *parser);
 static ASTNode *parserStructStatements(Parser *parser);
 
 static void parserSemi(Parser *parser);
@@ -44,39 +54,288 @@ static void parserRparen(Parser *parser);
 static void parserLbrace(Parser *parser);
 static void parserRbrace(Parser *parser);
 
-static ASTNode *parserImportStatement(Parser *parser);
+static void parserImportStatement(Parser *parser, u64 index);
+static b8 parserResolve(const char *importer, const char *name,
+                        char *out_path);
+static b8 parserFind(char **paths, const char *path);
+static ParserModule *parserModule(ParserModules *modules, const char *path);
+static void parserDiscover(ParserModules *modules, const char *importer,
+                           const char *source, Token *tokens);
+static b8 parserDiscoverPath(ParserModules *modules, const char *path);
+static void parserModuleTask(void *data);
+static void parserModuleDestroy(ParserModule *module);
+static void parserImportsDestroy(ParserImport *imports);
+static void parserBodiesDestroy(ParserBody **bodies);
+static void parserStringsDestroy(char **strings);
+static void parserSplice(ParserModules *modules, ASTNode *nodes,
+                         ParserImport *imports, ASTNode **out);
+static void parserSpliceModule(ParserModules *modules, ParserImport *import,
+                               ASTNode **out);
 static ASTNode parserWhileStatement(Parser *parser);
 static ASTNode parserForStatement(Parser *parser);
+static ASTNode parserForInStatement(Parser *parser);
+static b8 parserForInb(Parser *parser);
 static ASTNode parserIfStatement(Parser *parser);
 static ASTNode parserReturnStatement(Parser *parser);
 static ASTNode parserContinueStatement(Parser *parser);
 static ASTNode parserBreakStatement(Parser *parser);
 static ASTNode parserPrintStatement(Parser *parser);
+static ASTNode parserYieldStatement(Parser *parser);
 
 static ASTNode parserFunDeclaration(Parser *parser);
+static ASTNode parserStructDeclaration(Parser *parser);
 static ASTNode parserVarDeclaration(Parser *parser, b8 need_type);
 static ASTNode parserFunParamDeclaration(Parser *parser);
 static ASTNode parserIdentDeclaration(Parser *parser, b8 need_type);
 
 static ASTNode parserStructlit(Parser *parser);
 static ASTNode parserBlock(Parser *parser);
+static ASTNode parserLazyBlock(Parser *parser);
 static ASTNode parserType(Parser *parser);
 
-void parserCreate(Token *tokens, Parser *out_parser) {
+void parserCreate(Token *tokens, const char *path, Parser *out_parser) {
+  out_parser->source = 0;
   out_parser->tokens = tokens;
   out_parser->current_token = 0;
+  out_parser->path = 0;
+  out_parser->imports = vectorCreate(ParserImport);
+  out_parser->bodies = vectorCreate(ParserBody *);
+  out_parser->strings = vectorCreate(char *);
+  out_parser->stream = false;
+  out_parser->retained = 0;
+  out_parser->kept = 0;
+
+  ParserModules *modules = malloc(sizeof(ParserModules));
+  modules->modules = vectorCreate(ParserModule *);
+  modules->paths = vectorCreate(char *);
+  modules->stack = vectorCreate(char *);
+  pthread_mutex_init(&modules->lock, 0);
+  threadGroupCreate(&modules->group);
+  out_parser->modules = modules;
+  out_parser->owns_modules = true;
+
+  if (path) {
+    char resolved[PATH_MAX];
+    out_parser->path = strdup(realpath(path, resolved) ? resolved : path);
+  }
 }
 
 void parserDestroy(Parser *parser) {
+  if (parser->owns_modules) {
+    ParserModules *modules = parser->modules;
+
+    /* a failed parse leaves the imports it started behind */
+    pthread_mutex_lock(&modules->lock);
+    b8 started = vectorLength(modules->modules) > 0;
+    pthread_mutex_unlock(&modules->lock);
+    if (started) {
+      threadPoolWait(&modules->group);
+    }
+
+    for (u32 i = 0; i < vectorLength(modules->modules); ++i) {
+      parserModuleDestroy(modules->modules[i]);
+    }
+    vectorDestroy(modules->modules);
+    /* both point into the modules */
+    vectorDestroy(modules->paths);
+    vectorDestroy(modules->stack);
+    pthread_mutex_destroy(&modules->lock);
+    threadGroupDestroy(&modules->group);
+    free(modules);
+
+    free(parser->path);
+  }
+
+  if (parser->imports) {
+    parserImportsDestroy(parser->imports);
+  }
+  if (parser->bodies) {
+    parserBodiesDestroy(parser->bodies);
+  }
+  /* the kept strings of a stream and the ones of a statement that failed */
+  if (parser->strings) {
+    parserStringsDestroy(parser->strings);
+  }
+
+  if (parser->stream) {
+    for (u32 i = 0; i < vectorLength(parser->retained); ++i) {
+      ASTNodeDestroy(&parser->retained[i]);
+    }
+    vectorDestroy(parser->retained);
+    parserStringsDestroy(parser->kept);
+    vectorDestroy(parser->tokens);
+
+    lexerDestroy(&parser->lexer);
+  }
+
+  parser->source = 0;
   parser->tokens = 0;
   parser->current_token = 0;
+  parser->path = 0;
+  parser->modules = 0;
+  parser->owns_modules = false;
+  parser->imports = 0;
+  parser->bodies = 0;
+  parser->strings = 0;
+  parser->stream = false;
+  parser->retained = 0;
+  parser->kept = 0;
 }
 
 ASTNode parserBuildAST(Parser *parser) {
   InterpreterValue interpreter_value = {};
+  ParserModules *modules = parser->modules;
+
+  /* the imports are parsed on the pool while the program itself is */
+  parserDiscover(modules, parser->path, parser->source, parser->tokens);
+  ASTNode *nodes = parserGlobalStatements(parser);
+
+  if (vectorLength(parser->imports) == 0) {
+    return parserMakeNode(parser, AST_NODE_TYPE_PROGRAMM, nodes,
+                          interpreter_value);
+  }
+
+  threadPoolWait(&modules->group);
+
+  if (parser->path) {
+    vectorPush(modules->stack, parser->path);
+  }
+
+  ASTNode *program = vectorCreate(ASTNode);
+  parserSplice(modules, nodes, parser->imports, &program);
+  vectorDestroy(nodes);
+
+  return parserMakeNode(parser, AST_NODE_TYPE_PROGRAMM, program,
+                        interpreter_value);
+}
+
+void parserCreateStream(const char *source, u64 length, const char *path,
+                        Parser *out_parser) {
+  parserCreate(vectorCreate(Token), path, out_parser);
+  out_parser->source = source;
+  out_parser->stream = true;
+  lexerCreate(source, length, &out_parser->lexer);
+  out_parser->retained = vectorCreate(ASTNode);
+  out_parser->kept = vectorCreate(char *);
+
+  /* importing the script back is a cycle */
+  if (out_parser->path) {
+    vectorPush(out_parser->modules->stack, out_parser->path);
+  }
+}
+
+b8 parserNextStatement(Parser *parser, ASTNode *out_statement) {
+  u32 line = parserLine(parser);
+  switch (parserToken(parser)->type) {
+  case TOKEN_TYPE_EOF:
+    return false;
+  case TOKEN_TYPE_IMPORT: {
+    /* spliced on the spot, there are no statements after it to wait for */
+    ParserModules *modules = parser->modules;
+    parserImportStatement(parser, 0);
+    ParserImport *import = &parser->imports[vectorLength(parser->imports) - 1];
+    if (import->path && parserDiscoverPath(modules, import->path)) {
+      threadPoolWait(&modules->group);
+    }
+
+    ASTNode *nodes = vectorCreate(ASTNode);
+    parserSpliceModule(modules, import, &nodes);
+
+    InterpreterValue interpreter_value = {};
+    *out_statement = parserMakeNode(parser, AST_NODE_TYPE_PROGRAMM, nodes,
+                                    interpreter_value);
+    out_statement->line = line;
+  } break;
+  default:
+    *out_statement = parserGlobalStatement(parser);
+  }
+
+  return true;
+}
+
+void parserStatementRelease(Parser *parser, ASTNode *statement) {
+  b8 tree = false;
+  b8 names = false;
+  parserRetention(statement, &tree, &names);
+
+  if (tree) {
+    vectorPush(parser->retained, *statement);
+  } else {
+    ASTNodeDestroy(statement);
+  }
+
+  for (u64 i = 0; i < vectorLength(parser->strings); ++i) {
+    if (tree || names) {
+      vectorPush(parser->kept, parser->strings[i]);
+    } else {
+      free(parser->strings[i]);
+    }
+  }
+  vectorClear(parser->strings);
+
+  /* the tokens past the statement were only looked at */
+  u64 consumed = parser->current_token;
+  u64 remaining = vectorLength(parser->tokens) - consumed;
 
-  return parserMakeNode(parser, AST_NODE_TYPE_PROGRAMM,
-                        parserGlobalStatements(parser), interpreter_value);
+  Token lookahead[remaining + 1];
+  memcpy(lookahead, parser->tokens + consumed, remaining * sizeof(Token));
+  vectorClear(parser->tokens);
+  for (u64 i = 0; i < remaining; ++i) {
+    vectorPush(parser->tokens, lookahead[i]);
+  }
+  parser->current_token = 0;
+}
+
+ASTNode *parserBodyBlock(ParserBody *body) {
+  if (__atomic_load_n(&body->parsed, __ATOMIC_ACQUIRE)) {
+    return &body->block;
+  }
+
+  pthread_mutex_lock(&body->lock);
+  if (body->parsed) {
+    pthread_mutex_unlock(&body->lock);
+    return &body->block;
+  }
+
+  /* on the heap, so it is intact after a jump back */
+  Parser *parser = calloc(1, sizeof(Parser));
+  parser->source = body->source;
+  parser->current_token = body->begin;
+  parser->bodies = vectorCreate(ParserBody *);
+  parser->strings = vectorCreate(char *);
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    parserDestroy(parser);
+    free(parser);
+    pthread_mutex_unlock(&body->lock);
+    errorRethrow(&trap.error);
+  }
+
+  if (!body->tokens) {
+    Lexer lexer = {};
+    lexerCreate(body->source, body->length, &lexer);
+    lexer.line = body->line;
+    body->tokens = lexerScan(&lexer);
+    body->lexed = true;
+    lexerDestroy(&lexer);
+  }
+  parser->tokens = body->tokens;
+
+  body->block = parserBlock(parser);
+  body->bodies = parser->bodies;
+  body->strings = parser->strings;
+  parser->bodies = 0;
+  parser->strings = 0;
+  __atomic_store_n(&body->parsed, true, __ATOMIC_RELEASE);
+
+  errorTrapPop(&trap);
+  parserDestroy(parser);
+  free(parser);
+  pthread_mutex_unlock(&body->lock);
+
+  return &body->block;
 }
 
 static ASTNode parserMakeNode(Parser *parser, ASTNodeType type,
@@ -85,21 +344,107 @@ static ASTNode parserMakeNode(Parser *parser, ASTNodeType type,
   node.type = type;
   node.children = children;
   node.value = value;
+  node.line = parserLine(parser);
 
   return node;
 }
 
+/* line of the current token, errors past the end report the last one */
+static u32 parserLine(Parser *parser) {
+  parserFill(parser, parser->current_token);
+
+  u64 length = vectorLength(parser->tokens);
+  if (length == 0) {
+    return 0;
+  }
+
+  u64 index = parser->current_token < length ? parser->current_token
+                                             : length - 1;
+  return parser->tokens[index].line;
+}
+
+/* a stream lexes tokens as the parser reaches them */
+static void parserFill(Parser *parser, u64 index) {
+  while (parser->stream && index >= vectorLength(parser->tokens)) {
+    u64 length = vectorLength(parser->tokens);
+    if (length > 0 && parser->tokens[length - 1].type == TOKEN_TYPE_EOF) {
+      return;
+    }
+
+    vectorPush(parser->tokens, lexerNext(&parser->lexer));
+  }
+}
+
+/* what of a statement that ran outlives it. the scope refers to declared
+ * names, and to functions, structs and spawned calls as a whole */
+static void parserRetention(ASTNode *node, b8 *out_tree, b8 *out_names) {
+  switch (node->type) {
+  case AST_NODE_TYPE_FUN:
+  case AST_NODE_TYPE_STRUCT:
+  case AST_NODE_TYPE_SPAWN:
+  case AST_NODE_TYPE_PROGRAMM:
+    *out_tree = true;
+    return;
+  case AST_NODE_TYPE_VAR:
+    *out_names = true;
+    break;
+  default:
+    break;
+  }
+
+  if (node->children) {
+    for (u32 i = 0; i < vectorLength(node->children) && !*out_tree; ++i) {
+      parserRetention(&node->children[i], out_tree, out_names);
+    }
+  }
+}
+
 static Token *parserToken(Parser *parser) {
+  parserFill(parser, parser->current_token);
   if (parser->current_token >= vectorLength(parser->tokens)) {
-    FATAL("liv: recieved end of tokens when trying to get current token!");
+    RAISE("liv: recieved end of tokens when trying to get current token!");
   }
 
   return &parser->tokens[parser->current_token];
 }
 
+/* the value a node takes from the token, keywords and punctuation have
+ * none */
+static InterpreterValue parserValue(Parser *parser, Token *token) {
+  InterpreterValue value = {};
+
+  switch (token->type) {
+  case TOKEN_TYPE_INTLIT:
+  case TOKEN_TYPE_FLOATLIT:
+  case TOKEN_TYPE_CHARLIT:
+    value = lexerTokenValue(parser->source, token);
+    break;
+  case TOKEN_TYPE_STRLIT:
+    value.string = parserString(parser, token);
+    break;
+  case TOKEN_TYPE_IDENT:
+    value.identifier = parserString(parser, token);
+    break;
+  default:
+    break;
+  }
+
+  return value;
+}
+
+/* a terminated copy for the tree, owned by the parser */
+static char *parserString(Parser *parser, Token *token) {
+  char *string = malloc(token->length + 1);
+  lexerTokenString(parser->source, token, string);
+  vectorPush(parser->strings, string);
+
+  return string;
+}
+
 static void parserNextToken(Parser *parser) {
+  parserFill(parser, parser->current_token);
   if (parser->current_token == vectorLength(parser->tokens)) {
-    FATAL("liv: recieved end of tokens when trying to get next token!");
+    RAISE("liv: recieved end of tokens when trying to get next token!");
   }
 
   parser->current_token++;
@@ -107,7 +452,7 @@ static void parserNextToken(Parser *parser) {
 
 static void parserPrevToken(Parser *parser) {
   if (parser->current_token == 0) {
-    FATAL("liv: received start of tokens when trying to get prev token!");
+    RAISE("liv: received start of tokens when trying to get prev token!");
   }
 
   parser->current_token--;
@@ -156,8 +501,7 @@ static ASTNodeType parserArithop(Parser *parser, TokenType type) {
     o = AST_NODE_TYPE_OR;
     break;
   default:
-    FATAL("liv: unknown token type!");
-    tokenPrint(parserToken(parser));
+    RAISE_AT(parserLine(parser), "liv: unknown token type!");
   }
 
   return o;
@@ -165,7 +509,8 @@ static ASTNodeType parserArithop(Parser *parser, TokenType type) {
 
 static i32 parserOperationPrecedence(Parser *parser, ASTNodeType type) {
   if ((i32)type > 12) {
-    FATAL("liv: unknown operation precedence: %d!", (i32)type);
+    RAISE_AT(parserLine(parser),
+             "liv: unknown operation precedence: %d!", (i32)type);
   }
 
   const i32 operation_precedence[] = {
@@ -196,7 +541,7 @@ static b8 parserOperationBinary(Parser *parser) {
 
 static void parserMatch(Parser *parser, TokenType type) {
   if (parserToken(parser)->type != type) {
-    FATAL("liv: no matches for provided token type!");
+    RAISE_AT(parserLine(parser), "liv: no matches for provided token type!");
   }
 
   parserNextToken(parser);
@@ -208,7 +553,8 @@ static b8 parserMatchb(Parser *parser, TokenType type) {
 
 static void parserMatchStr(Parser *parser) {
   if (parserToken(parser)->type != TOKEN_TYPE_STRLIT) {
-    FATAL("liv: token type doesn't match string literal type!");
+    RAISE_AT(parserLine(parser),
+             "liv: token type doesn't match string literal type!");
   }
 }
 
@@ -217,17 +563,17 @@ static void parserMatchType(Parser *parser) {
   if (type != TOKEN_TYPE_INT && type != TOKEN_TYPE_FLOAT &&
       type != TOKEN_TYPE_CHAR && type != TOKEN_TYPE_VOID &&
       type != TOKEN_TYPE_STRING && type != TOKEN_TYPE_IDENT) {
-    FATAL("liv: token type doesn't match type!");
+    RAISE_AT(parserLine(parser), "liv: token type doesn't match type!");
   }
 }
 
 static ASTNode parserIdent(Parser *parser) {
   if (parserToken(parser)->type != TOKEN_TYPE_IDENT) {
-    FATAL("liv: expect identifier but got %s", parserToken(parser)->type);
+    RAISE_AT(parserLine(parser), "liv: expected an identifier!");
   }
 
   ASTNode node = parserMakeNode(parser, AST_NODE_TYPE_IDENT, 0,
-                                parserToken(parser)->value);
+                                parserValue(parser, parserToken(parser)));
 
   parserNextToken(parser);
 
@@ -244,16 +590,35 @@ static ASTNode parserPrefix(Parser *parser) {
     InterpreterValue interpreter_value = {};
     node = parserMakeNode(parser, AST_NODE_TYPE_NOT, nodes, interpreter_value);
     break;
+  case TOKEN_TYPE_SPAWN: {
+    parserNextToken(parser);
+    ASTNode *nodes = vectorCreate(ASTNode);
+    ASTNode call = parserLiteral(parser);
+    if (call.type != AST_NODE_TYPE_FUNC_CALL) {
+      RAISE_AT(parserLine(parser), "liv: spawn expects a function call!");
+    }
+    vectorPush(nodes, call);
+    InterpreterValue interpreter_value = {};
+    node =
+        parserMakeNode(parser, AST_NODE_TYPE_SPAWN, nodes, interpreter_value);
+  } break;
+  case TOKEN_TYPE_AWAIT: {
+    parserNextToken(parser);
+    ASTNode *nodes = vectorCreate(ASTNode);
+    vectorPush(nodes, parserLiteral(parser));
+    InterpreterValue interpreter_value = {};
+    node =
+        parserMakeNode(parser, AST_NODE_TYPE_AWAIT, nodes, interpreter_value);
+  } break;
   default:
-    FATAL("liv: token type doesn't match prefix type!");
-    tokenPrint(parserToken(parser));
+    RAISE_AT(parserLine(parser), "liv: token type doesn't match prefix type!");
   }
 
   return node;
 }
 
 static ASTNode parserPostfix(Parser *parser) {
-  InterpreterValue value = parserToken(parser)->value;
+  InterpreterValue value = parserValue(parser, parserToken(parser));
   parserNextToken(parser);
 
   ASTNode node = {};
@@ -279,6 +644,11 @@ static ASTNode parserPostfix(Parser *parser) {
     node = parserMakeNode(parser, AST_NODE_TYPE_IDENT, 0, value);
   }
 
+  /* p.x, pts[i].x and make().x */
+  while (parserToken(parser)->type == TOKEN_TYPE_DOT) {
+    node = parserFieldAccess(parser, node);
+  }
+
   return node;
 }
 
@@ -288,19 +658,19 @@ static ASTNode parserLiteral(Parser *parser) {
   switch (parserToken(parser)->type) {
   case TOKEN_TYPE_INTLIT:
     node = parserMakeNode(parser, AST_NODE_TYPE_INTLIT, 0,
-                          parserToken(parser)->value);
+                          parserValue(parser, parserToken(parser)));
     break;
   case TOKEN_TYPE_FLOATLIT:
     node = parserMakeNode(parser, AST_NODE_TYPE_FLOATLIT, 0,
-                          parserToken(parser)->value);
+                          parserValue(parser, parserToken(parser)));
     break;
   case TOKEN_TYPE_CHARLIT:
     node = parserMakeNode(parser, AST_NODE_TYPE_CHARLIT, 0,
-                          parserToken(parser)->value);
+                          parserValue(parser, parserToken(parser)));
     break;
   case TOKEN_TYPE_STRLIT:
     node = parserMakeNode(parser, AST_NODE_TYPE_STRLIT, 0,
-                          parserToken(parser)->value);
+                          parserValue(parser, parserToken(parser)));
     break;
   case TOKEN_TYPE_LPAREN:
     parserNextToken(parser);
@@ -330,14 +700,55 @@ static ASTNode parserArrayAccess(Parser *parser) {
   ASTNode *nodes = vectorCreate(ASTNode);
   vectorPush(nodes, parserIdent(parser));
 
-  parserLbrack(parser);
+  InterpreterValue interpreter_value = {};
+  /* arr[i][j] keeps every index in one node, only the last may be a slice */
+  while (1) {
+    parserLbrack(parser);
 
-  vectorPush(nodes, parserBinexpr(parser, 0));
+    /* omitted slice bounds are stored as void nodes */
+    if (parserColonb(parser)) {
+      vectorPush(nodes, parserMakeNode(parser, AST_NODE_TYPE_VOID, 0,
+                                       interpreter_value));
+    } else {
+      vectorPush(nodes, parserBinexpr(parser, 0));
+    }
+
+    if (parserColonb(parser)) {
+      break;
+    }
+
+    parserRbrack(parser);
+
+    if (parserToken(parser)->type != TOKEN_TYPE_LBRACK) {
+      return parserMakeNode(parser, AST_NODE_TYPE_ARR_ACCESS, nodes,
+                            interpreter_value);
+    }
+  }
+
+  parserColon(parser);
+  if (parserToken(parser)->type == TOKEN_TYPE_RBRACK) {
+    vectorPush(nodes, parserMakeNode(parser, AST_NODE_TYPE_VOID, 0,
+                                     interpreter_value));
+  } else {
+    vectorPush(nodes, parserBinexpr(parser, 0));
+  }
 
   parserRbrack(parser);
 
+  return parserMakeNode(parser, AST_NODE_TYPE_ARR_SLICE, nodes,
+                        interpreter_value);
+}
+
+static ASTNode parserFieldAccess(Parser *parser, ASTNode object) {
+  parserMatch(parser, TOKEN_TYPE_DOT);
+
+  ASTNode *nodes = vectorCreate(ASTNode);
+  vectorPush(nodes, object);
+  vectorPush(nodes, parserIdent(parser));
+
+  /* the value caches the resolved slot, see evalFieldAccess */
   InterpreterValue interpreter_value = {};
-  return parserMakeNode(parser, AST_NODE_TYPE_ARR_ACCESS, nodes,
+  return parserMakeNode(parser, AST_NODE_TYPE_FIELD_ACCESS, nodes,
                         interpreter_value);
 }
 
@@ -399,52 +810,63 @@ static ASTNode parserBinexpr(Parser *parser, i32 pr) {
 static ASTNode *parserGlobalStatements(Parser *parser) {
   ASTNode *nodes = vectorCreate(ASTNode);
 
-  b8 run = true;
-  while (run) {
-    ASTNode node = {};
-    switch (parserToken(parser)->type) {
-    case TOKEN_TYPE_IMPORT: {
-      ASTNode *imp_nodes = parserImportStatement(parser);
-      for (u32 i = 0; i < vectorLength(imp_nodes); ++i) {
-        vectorPush(nodes, imp_nodes[i]);
-      }
-      continue;
-    }
-    case TOKEN_TYPE_VAR:
-      node = parserVarDeclaration(parser, true);
-      parserSemi(parser);
-      break;
-    case TOKEN_TYPE_IF:
-      node = parserIfStatement(parser);
-      break;
-    case TOKEN_TYPE_FOR:
-      node = parserForStatement(parser);
-      break;
-    case TOKEN_TYPE_WHILE:
-      node = parserWhileStatement(parser);
-      break;
-    case TOKEN_TYPE_FUN:
-      node = parserFunDeclaration(parser);
+  for (;;) {
+    TokenType type = parserToken(parser)->type;
+    if (type == TOKEN_TYPE_EOF) {
       break;
-    case TOKEN_TYPE_PRINT:
-      node = parserPrintStatement(parser);
-      parserSemi(parser);
-      break;
-      break;
-    case TOKEN_TYPE_EOF:
-      run = false;
+    }
+
+    if (type == TOKEN_TYPE_IMPORT) {
+      parserImportStatement(parser, vectorLength(nodes));
       continue;
-    default:
-      node = parserBinexpr(parser, 0);
-      parserSemi(parser);
     }
 
-    vectorPush(nodes, node);
+    vectorPush(nodes, parserGlobalStatement(parser));
   }
 
   return nodes;
 }
 
+/* any top-level statement but an import */
+static ASTNode parserGlobalStatement(Parser *parser) {
+  ASTNode node = {};
+  /* a statement is located by its first token */
+  u32 line = parserLine(parser);
+  switch (parserToken(parser)->type) {
+  case TOKEN_TYPE_VAR:
+    node = parserVarDeclaration(parser, true);
+    parserSemi(parser);
+    break;
+  case TOKEN_TYPE_IF:
+    node = parserIfStatement(parser);
+    break;
+  case TOKEN_TYPE_FOR:
+  case TOKEN_TYPE_PFOR:
+    node = parserForStatement(parser);
+    break;
+  case TOKEN_TYPE_WHILE:
+    node = parserWhileStatement(parser);
+    break;
+  case TOKEN_TYPE_FUN:
+    node = parserFunDeclaration(parser);
+    break;
+  case TOKEN_TYPE_STRUCT:
+    node = parserStructDeclaration(parser);
+    break;
+  case TOKEN_TYPE_PRINT:
+    node = parserPrintStatement(parser);
+    parserSemi(parser);
+    break;
+  default:
+    node = parserBinexpr(parser, 0);
+    parserSemi(parser);
+  }
+
+  node.line = line;
+
+  return node;
+}
+
 static ASTNode *parserStructStatements(Parser *parser) {
   ASTNode *nodes = vectorCreate(ASTNode);
 
@@ -452,6 +874,10 @@ static ASTNode *parserStructStatements(Parser *parser) {
   while (run) {
     ASTNode node = {};
     switch (parserToken(parser)->type) {
+    case TOKEN_TYPE_VAR:
+      node = parserVarDeclaration(parser, true);
+      parserSemi(parser);
+      break;
     case TOKEN_TYPE_FUN:
       node = parserFunDeclaration(parser);
       break;
@@ -459,8 +885,8 @@ static ASTNode *parserStructStatements(Parser *parser) {
       run = false;
       continue;
     default:
-      FATAL("liv: token doesn't match struct statement type!");
-      tokenPrint(parserToken(parser));
+      RAISE_AT(parserLine(parser),
+               "liv: token doesn't match struct statement type!");
     }
 
     vectorPush(nodes, node);
@@ -503,36 +929,276 @@ static void parserRbrace(Parser *parser) {
   parserMatch(parser, TOKEN_TYPE_RBRACE);
 }
 
-static ASTNode *parserImportStatement(Parser *parser) {
+static void parserImportStatement(Parser *parser, u64 index) {
+  u32 line = parserLine(parser);
   parserMatch(parser, TOKEN_TYPE_IMPORT);
 
   parserMatchStr(parser);
-  InterpreterValue value = parserToken(parser)->value;
+  InterpreterValue value = parserValue(parser, parserToken(parser));
   parserNextToken(parser);
 
   parserSemi(parser);
 
-  char *buf;
-  if (!readFile(value.string, &buf)) {
-    FATAL("liv: failed to read file %s!", value.string);
+  /* a missing file is reported by the splice, in program order */
+  char path[PATH_MAX];
+  b8 resolved = parserResolve(parser->path, value.string, path);
+
+  ParserImport import = {};
+  import.name = value.string;
+  import.path = resolved ? strdup(path) : 0;
+  import.index = index;
+  import.line = line;
+  vectorPush(parser->imports, import);
+}
+
+/* canonical path of an import, relative to the importing file */
+static b8 parserResolve(const char *importer, const char *name,
+                        char *out_path) {
+  const char *slash = importer ? strrchr(importer, '/') : 0;
+  if (name[0] == '/' || !slash) {
+    return realpath(name, out_path) != 0;
+  }
+
+  char joined[PATH_MAX];
+  i32 directory = slash - importer + 1;
+  if (snprintf(joined, sizeof(joined), "%.*s%s", directory, importer, name) >=
+      sizeof(joined)) {
+    return false;
+  }
+
+  return realpath(joined, out_path) != 0;
+}
+
+static b8 parserFind(char **paths, const char *path) {
+  for (u32 i = 0; i < vectorLength(paths); ++i) {
+    if (!strcmp(paths[i], path)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static ParserModule *parserModule(ParserModules *modules, const char *path) {
+  for (u32 i = 0; i < vectorLength(modules->modules); ++i) {
+    if (!strcmp(modules->modules[i]->path, path)) {
+      return modules->modules[i];
+    }
+  }
+
+  return 0;
+}
+
+/* a scan of the tokens, so a file's imports start before it is parsed.
+ * imports that do not resolve are left to the parser to report */
+static void parserDiscover(ParserModules *modules, const char *importer,
+                           const char *source, Token *tokens) {
+  for (u64 i = 0; i + 1 < vectorLength(tokens); ++i) {
+    if (tokens[i].type != TOKEN_TYPE_IMPORT ||
+        tokens[i + 1].type != TOKEN_TYPE_STRLIT) {
+      continue;
+    }
+
+    char name[tokens[i + 1].length + 1];
+    lexerTokenString(source, &tokens[i + 1], name);
+
+    char path[PATH_MAX];
+    if (parserResolve(importer, name, path)) {
+      parserDiscoverPath(modules, path);
+    }
+  }
+}
+
+/* starts parsing the module at path, false if it was known already */
+static b8 parserDiscoverPath(ParserModules *modules, const char *path) {
+  pthread_mutex_lock(&modules->lock);
+
+  b8 added = !parserModule(modules, path);
+  if (added) {
+    ParserModule *module = calloc(1, sizeof(ParserModule));
+    module->owner = modules;
+    module->path = strdup(path);
+    vectorPush(modules->modules, module);
+    threadPoolSubmit(&modules->group, parserModuleTask, module);
+  }
+
+  pthread_mutex_unlock(&modules->lock);
+
+  return added;
+}
+
+static void parserModuleTask(void *data) {
+  ParserModule *module = data;
+
+  FileView source;
+  if (!fileViewOpen(module->path, &source)) {
+    module->unreadable = true;
+    return;
   }
 
-  Lexer lexer = {};
-  lexerCreate(buf, &lexer);
+  /* on the heap, so it is intact after a jump back */
+  Parser *parser = calloc(1, sizeof(Parser));
+  parser->source = source.data;
+  parser->path = module->path;
+  parser->modules = module->owner;
+  parser->imports = vectorCreate(ParserImport);
+  parser->bodies = vectorCreate(ParserBody *);
+  parser->strings = vectorCreate(char *);
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) != 0) {
+    module->error = malloc(sizeof(Error));
+    *module->error = trap.error;
+  } else {
+    Lexer lexer = {};
+    lexerCreate(source.data, source.length, &lexer);
+    parser->tokens = lexerScan(&lexer);
+    lexerDestroy(&lexer);
+
+    parserDiscover(module->owner, module->path, source.data, parser->tokens);
+    module->nodes = parserGlobalStatements(parser);
+    module->imports = parser->imports;
+    module->bodies = parser->bodies;
+    module->strings = parser->strings;
+    module->tokens = parser->tokens;
+    module->source = source;
+    parser->imports = 0;
+    parser->bodies = 0;
+    parser->strings = 0;
+    parser->tokens = 0;
+
+    errorTrapPop(&trap);
+  }
 
-  Token *tokens = lexerScan(&lexer);
+  /* left by an error */
+  if (module->error) {
+    if (parser->tokens) {
+      vectorDestroy(parser->tokens);
+    }
+    fileViewClose(&source);
+  }
+  parserDestroy(parser);
+  free(parser);
+}
 
-  Parser import_parser;
-  parserCreate(tokens, &import_parser);
+static void parserModuleDestroy(ParserModule *module) {
+  if (module->nodes) {
+    for (u32 i = 0; i < vectorLength(module->nodes); ++i) {
+      ASTNodeDestroy(&module->nodes[i]);
+    }
+    vectorDestroy(module->nodes);
+  }
+  if (module->imports) {
+    parserImportsDestroy(module->imports);
+  }
+  if (module->bodies) {
+    parserBodiesDestroy(module->bodies);
+  }
+  if (module->strings) {
+    parserStringsDestroy(module->strings);
+  }
+  if (module->tokens) {
+    vectorDestroy(module->tokens);
+    fileViewClose(&module->source);
+  }
+
+  free(module->error);
+  free(module->path);
+  free(module);
+}
 
-  ASTNode tree = parserBuildAST(&import_parser);
+static void parserImportsDestroy(ParserImport *imports) {
+  for (u32 i = 0; i < vectorLength(imports); ++i) {
+    free(imports[i].path);
+  }
+  vectorDestroy(imports);
+}
 
-  free(buf);
-  lexerDestroy(&lexer);
-  vectorDestroy(tokens);
-  parserDestroy(&import_parser);
+ParserBody *parserBodyCreate(const char *source, u64 length, u32 line,
+                             b8 yields) {
+  ParserBody *body = calloc(1, sizeof(ParserBody));
+  body->source = source;
+  body->length = length;
+  body->line = line;
+  body->yields = yields;
+  pthread_mutex_init(&body->lock, 0);
 
-  return tree.children;
+  return body;
+}
+
+void parserBodyDestroy(ParserBody *body) {
+  if (body->parsed) {
+    ASTNodeDestroy(&body->block);
+    parserBodiesDestroy(body->bodies);
+    parserStringsDestroy(body->strings);
+  }
+  if (body->lexed) {
+    vectorDestroy(body->tokens);
+  }
+  pthread_mutex_destroy(&body->lock);
+  free(body);
+}
+
+static void parserBodiesDestroy(ParserBody **bodies) {
+  for (u32 i = 0; i < vectorLength(bodies); ++i) {
+    parserBodyDestroy(bodies[i]);
+  }
+  vectorDestroy(bodies);
+}
+
+static void parserStringsDestroy(char **strings) {
+  for (u32 i = 0; i < vectorLength(strings); ++i) {
+    free(strings[i]);
+  }
+  vectorDestroy(strings);
+}
+
+/* appends nodes to out, with the module of every import in its place */
+static void parserSplice(ParserModules *modules, ASTNode *nodes,
+                         ParserImport *imports, ASTNode **out) {
+  u32 next = 0;
+  for (u64 i = 0; i <= vectorLength(nodes); ++i) {
+    for (; next < vectorLength(imports) && imports[next].index == i; ++next) {
+      parserSpliceModule(modules, &imports[next], out);
+    }
+
+    if (i < vectorLength(nodes)) {
+      vectorPush(*out, nodes[i]);
+    }
+  }
+}
+
+static void parserSpliceModule(ParserModules *modules, ParserImport *import,
+                               ASTNode **out) {
+  if (import->path && parserFind(modules->stack, import->path)) {
+    RAISE_AT(import->line, "liv: import cycle through %s!", import->name);
+  }
+
+  ParserModule *module =
+      import->path ? parserModule(modules, import->path) : 0;
+  if (!module || module->unreadable) {
+    RAISE_AT(import->line, "liv: failed to read file %s!", import->name);
+  }
+  if (module->error) {
+    errorRethrow(module->error);
+  }
+
+  /* spliced in by an earlier import, its definitions are global */
+  if (module->spliced) {
+    return;
+  }
+  module->spliced = true;
+  vectorPush(modules->paths, module->path);
+
+  vectorPush(modules->stack, module->path);
+  parserSplice(modules, module->nodes, module->imports, out);
+  char *spliced;
+  vectorPop(modules->stack, &spliced);
+
+  /* the nodes moved into out */
+  vectorDestroy(module->nodes);
+  module->nodes = 0;
 }
 
 static ASTNode parserWhileStatement(Parser *parser) {
@@ -548,9 +1214,20 @@ static ASTNode parserWhileStatement(Parser *parser) {
   return parserMakeNode(parser, AST_NODE_TYPE_WHILE, nodes, interpreter_value);
 }
 
+/* for and pfor share the header, pfor's shape is checked at evaluation */
 static ASTNode parserForStatement(Parser *parser) {
   ASTNode *nodes = vectorCreate(ASTNode);
-  parserMatch(parser, TOKEN_TYPE_FOR);
+  u8 type = AST_NODE_TYPE_FOR;
+  if (parserToken(parser)->type == TOKEN_TYPE_PFOR) {
+    type = AST_NODE_TYPE_PFOR;
+    parserNextToken(parser);
+  } else {
+    parserMatch(parser, TOKEN_TYPE_FOR);
+
+    if (parserForInb(parser)) {
+      return parserForInStatement(parser);
+    }
+  }
 
   parserLparen(parser);
   if (parserToken(parser)->type == TOKEN_TYPE_VAR) {
@@ -567,7 +1244,50 @@ static ASTNode parserForStatement(Parser *parser) {
   vectorPush(nodes, parserBlock(parser));
 
   InterpreterValue interpreter_value = {};
-  return parserMakeNode(parser, AST_NODE_TYPE_FOR, nodes, interpreter_value);
+  return parserMakeNode(parser, type, nodes, interpreter_value);
+}
+
+/* for x in xs { .. } and for (x in xs) { .. }, after the for keyword.
+ * for i in lo..hi { .. } counts from lo up to hi exclusive */
+static ASTNode parserForInStatement(Parser *parser) {
+  ASTNode *nodes = vectorCreate(ASTNode);
+  u8 type = AST_NODE_TYPE_FOR_IN;
+
+  b8 paren = parserMatchb(parser, TOKEN_TYPE_LPAREN);
+  if (paren) {
+    parserNextToken(parser);
+  }
+
+  vectorPush(nodes, parserIdent(parser));
+  parserMatch(parser, TOKEN_TYPE_IN);
+  vectorPush(nodes, parserBinexpr(parser, 0));
+
+  if (parserMatchb(parser, TOKEN_TYPE_DOTDOT)) {
+    parserNextToken(parser);
+    vectorPush(nodes, parserBinexpr(parser, 0));
+    type = AST_NODE_TYPE_FOR_RANGE;
+  }
+
+  if (paren) {
+    parserRparen(parser);
+  }
+
+  vectorPush(nodes, parserBlock(parser));
+
+  InterpreterValue interpreter_value = {};
+  return parserMakeNode(parser, type, nodes, interpreter_value);
+}
+
+static b8 parserForInb(Parser *parser) {
+  u64 index = parser->current_token;
+  parserFill(parser, index + 2);
+  if (parser->tokens[index].type == TOKEN_TYPE_LPAREN) {
+    index++;
+  }
+
+  return index + 1 < vectorLength(parser->tokens) &&
+         parser->tokens[index].type == TOKEN_TYPE_IDENT &&
+         parser->tokens[index + 1].type == TOKEN_TYPE_IN;
 }
 
 static ASTNode parserIfStatement(Parser *parser) {
@@ -643,6 +1363,17 @@ static ASTNode parserBreakStatement(Parser *parser) {
   return parserMakeNode(parser, AST_NODE_TYPE_BREAK, nodes, interpreter_value);
 }
 
+static ASTNode parserYieldStatement(Parser *parser) {
+  ASTNode *nodes = vectorCreate(ASTNode);
+  parserMatch(parser, TOKEN_TYPE_YIELD);
+
+  vectorPush(nodes, parserBinexpr(parser, 0));
+  parserSemi(parser);
+
+  InterpreterValue interpreter_value = {};
+  return parserMakeNode(parser, AST_NODE_TYPE_YIELD, nodes, interpreter_value);
+}
+
 static ASTNode parserPrintStatement(Parser *parser) {
   ASTNode *nodes = vectorCreate(ASTNode);
   parserMatch(parser, TOKEN_TYPE_PRINT);
@@ -696,12 +1427,33 @@ static ASTNode parserFunDeclaration(Parser *parser) {
                                      interpreter_value));
   }
 
-  vectorPush(nodes, parserBlock(parser));
+  vectorPush(nodes, parser->stream ? parserBlock(parser)
+                                   : parserLazyBlock(parser));
 
   InterpreterValue interpreter_value = {};
   return parserMakeNode(parser, AST_NODE_TYPE_FUN, nodes, interpreter_value);
 }
 
+static ASTNode parserStructDeclaration(Parser *parser) {
+  parserMatch(parser, TOKEN_TYPE_STRUCT);
+
+  ASTNode *nodes = vectorCreate(ASTNode);
+  vectorPush(nodes, parserIdent(parser));
+
+  parserLbrace(parser);
+
+  ASTNode *statements = parserStructStatements(parser);
+  for (u32 i = 0; i < vectorLength(statements); ++i) {
+    vectorPush(nodes, statements[i]);
+  }
+  vectorDestroy(statements);
+
+  parserRbrace(parser);
+
+  InterpreterValue interpreter_value = {};
+  return parserMakeNode(parser, AST_NODE_TYPE_STRUCT, nodes, interpreter_value);
+}
+
 static ASTNode parserVarDeclaration(Parser *parser, b8 need_type) {
   parserMatch(parser, TOKEN_TYPE_VAR);
 
@@ -722,7 +1474,7 @@ static ASTNode parserVarDeclaration(Parser *parser, b8 need_type) {
 }
 
 static ASTNode parserFunParamDeclaration(Parser *parser) {
-  InterpreterValue value = parserToken(parser)->value;
+  InterpreterValue value = parserValue(parser, parserToken(parser));
   parserMatch(parser, TOKEN_TYPE_IDENT);
   b8 arr = false;
 
@@ -765,15 +1517,18 @@ static ASTNode parserIdentDeclaration(Parser *parser, b8 need_type) {
   ASTNode *ident_nodes = vectorCreate(ASTNode);
   ASTNode *arr_nodes = vectorCreate(ASTNode);
 
-  InterpreterValue ident_value = parserToken(parser)->value;
+  InterpreterValue ident_value = parserValue(parser, parserToken(parser));
   parserMatch(parser, TOKEN_TYPE_IDENT);
   b8 arr = false;
   b8 have_type = !need_type;
 
-  if (parserToken(parser)->type == TOKEN_TYPE_LBRACK) {
+  /* one extent per dimension, var m[rows][cols] */
+  InterpreterValue rank = {};
+  while (parserToken(parser)->type == TOKEN_TYPE_LBRACK) {
     parserNextToken(parser);
     vectorPush(arr_nodes, parserBinexpr(parser, 0));
     parserRbrack(parser);
+    rank.integer++;
     arr = true;
   }
 
@@ -797,9 +1552,7 @@ static ASTNode parserIdentDeclaration(Parser *parser, b8 need_type) {
       init = true;
     }
 
-    InterpreterValue interpreter_value = {};
-    ident = parserMakeNode(parser, AST_NODE_TYPE_ARRAY, arr_nodes,
-                           interpreter_value);
+    ident = parserMakeNode(parser, AST_NODE_TYPE_ARRAY, arr_nodes, rank);
     if (init) {
       return ident;
     }
@@ -821,7 +1574,8 @@ static ASTNode parserIdentDeclaration(Parser *parser, b8 need_type) {
   }
 
   if (!have_type) {
-    FATAL("liv: no type is provided for ident declaration!");
+    RAISE_AT(parserLine(parser),
+             "liv: no type is provided for ident declaration!");
   }
 
   return ident;
@@ -849,6 +1603,60 @@ static ASTNode parserStructlit(Parser *parser) {
                         interpreter_value);
 }
 
+/* steps over a function body by matching its braces */
+static ASTNode parserLazyBlock(Parser *parser) {
+  ParserBody *body = calloc(1, sizeof(ParserBody));
+  body->source = parser->source;
+  body->tokens = parser->tokens;
+  body->begin = parser->current_token;
+  body->path = parser->path;
+  pthread_mutex_init(&body->lock, 0);
+  vectorPush(parser->bodies, body);
+
+  parserLbrace(parser);
+
+  /* depth at which a nested function's body opened, its yields are its
+   * own */
+  u32 depth = 1;
+  u32 nested = 0;
+  b8 nested_next = false;
+  while (depth > 0) {
+    switch (parserToken(parser)->type) {
+    case TOKEN_TYPE_EOF:
+      parserRbrace(parser);
+      break;
+    case TOKEN_TYPE_FUN:
+      nested_next = nested == 0;
+      break;
+    case TOKEN_TYPE_LBRACE:
+      depth++;
+      if (nested_next) {
+        nested = depth;
+        nested_next = false;
+      }
+      break;
+    case TOKEN_TYPE_RBRACE:
+      if (depth == nested) {
+        nested = 0;
+      }
+      depth--;
+      break;
+    case TOKEN_TYPE_YIELD:
+      body->yields = body->yields || nested == 0;
+      break;
+    default:
+      break;
+    }
+    parserNextToken(parser);
+  }
+  body->end = parser->current_token;
+
+  InterpreterValue interpreter_value = {};
+  interpreter_value.body = body;
+  return parserMakeNode(parser, AST_NODE_TYPE_LAZY_BLOCK, 0,
+                        interpreter_value);
+}
+
 static ASTNode parserBlock(Parser *parser) {
   parserLbrace(parser);
 
@@ -857,6 +1665,7 @@ static ASTNode parserBlock(Parser *parser) {
   b8 run = true;
   while (run) {
     ASTNode node;
+    u32 line = parserLine(parser);
     switch (parserToken(parser)->type) {
     case TOKEN_TYPE_VAR:
       node = parserVarDeclaration(parser, true);
@@ -866,6 +1675,7 @@ static ASTNode parserBlock(Parser *parser) {
       node = parserIfStatement(parser);
       break;
     case TOKEN_TYPE_FOR:
+    case TOKEN_TYPE_PFOR:
       node = parserForStatement(parser);
       break;
     case TOKEN_TYPE_WHILE:
@@ -874,6 +1684,9 @@ static ASTNode parserBlock(Parser *parser) {
     case TOKEN_TYPE_FUN:
       node = parserFunDeclaration(parser);
       break;
+    case TOKEN_TYPE_STRUCT:
+      node = parserStructDeclaration(parser);
+      break;
     case TOKEN_TYPE_RETURN:
       node = parserReturnStatement(parser);
       break;
@@ -883,6 +1696,9 @@ static ASTNode parserBlock(Parser *parser) {
     case TOKEN_TYPE_BREAK:
       node = parserBreakStatement(parser);
       break;
+    case TOKEN_TYPE_YIELD:
+      node = parserYieldStatement(parser);
+      break;
     case TOKEN_TYPE_PRINT:
       node = parserPrintStatement(parser);
       parserSemi(parser);
@@ -896,6 +1712,7 @@ static ASTNode parserBlock(Parser *parser) {
       parserSemi(parser);
     }
 
+    node.line = line;
     vectorPush(nodes, node);
   }
 
@@ -924,25 +1741,25 @@ static ASTNode parserType(Parser *parser) {
     break;
   case TOKEN_TYPE_IDENT:
     node = parserMakeNode(parser, AST_NODE_TYPE_IDENT, 0,
-                          parserToken(parser)->value);
+                          parserValue(parser, parserToken(parser)));
     break;
   default:
-    FATAL("liv: token type doesn't match the type!");
+    RAISE_AT(parserLine(parser), "liv: token type doesn't match the type!");
   }
   parserNextToken(parser);
   if (parserToken(parser)->type == TOKEN_TYPE_LBRACK) {
     ASTNode *nodes = vectorCreate(ASTNode);
     vectorPush(nodes, node);
 
-    parserNextToken(parser);
-    vectorPush(nodes, parserBinexpr(parser, 0));
-    parserRbrack(parser);
-
-    parserNextToken(parser);
+    InterpreterValue rank = {};
+    while (parserToken(parser)->type == TOKEN_TYPE_LBRACK) {
+      parserNextToken(parser);
+      vectorPush(nodes, parserBinexpr(parser, 0));
+      parserRbrack(parser);
+      rank.integer++;
+    }
 
-    InterpreterValue interpreter_value = {};
-    return parserMakeNode(parser, AST_NODE_TYPE_ARRAY, nodes,
-                          interpreter_value);
+    return parserMakeNode(parser, AST_NODE_TYPE_ARRAY, nodes, rank);
   }
 
   return node;
@@ -2,14 +2,128 @@
 
 #include "ast_node.h"
 #include "defines.h"
+#include "error.h"
+#include "file_io.h"
+#include "lexer.h"
+#include "thread_pool.h"
 #include "token.h"
 
+/* an import statement, its module is spliced in at index once every module
+ * has been parsed */
+typedef struct ParserImport {
+  /* as written, for messages */
+  char *name;
+  /* canonical path, null if the file does not exist */
+  char *path;
+  u64 index;
+  u32 line;
+} ParserImport;
+
+typedef struct ParserModules ParserModules;
+
+/* a function body the parser stepped over, it is parsed on the first call
+ * so startup pays only for the functions that run */
+typedef struct ParserBody {
+  /* tokens of its file and the source they span, the body starts at its
+   * opening brace and ends before end */
+  const char *source;
+  Token *tokens;
+  u64 begin;
+  u64 end;
+  /* canonical path of its file, null for a source string */
+  const char *path;
+  /* a body loaded from the cache has no tokens, it lexes the length bytes
+   * of its text at source from line on the first call */
+  u64 length;
+  u32 line;
+  b8 lexed;
+  /* has a yield outside of nested functions, a call makes a generator */
+  b8 yields;
+  b8 parsed;
+  ASTNode block;
+  char **strings;
+  /* bodies stepped over while parsing this one */
+  struct ParserBody **bodies;
+  pthread_mutex_t lock;
+} ParserBody;
+
+/* an imported file, lexed and parsed by a pool task */
+typedef struct ParserModule {
+  ParserModules *owner;
+  char *path;
+  /* kept for the bodies, the tokens point into the source */
+  FileView source;
+  Token *tokens;
+  ParserBody **bodies;
+  /* top-level statements, without the imports */
+  ASTNode *nodes;
+  char **strings;
+  ParserImport *imports;
+  /* failures wait for the splice, which reports them in program order */
+  b8 unreadable;
+  Error *error;
+  b8 spliced;
+} ParserModule;
+
+/* files imported while parsing one program. every reachable file is parsed
+ * once, concurrently with the others, and spliced in by its first import
+ * in program order. its definitions are shared by every importer */
+struct ParserModules {
+  ParserModule **modules;
+  /* canonical paths of the spliced files, nested imports included */
+  char **paths;
+  /* canonical paths of the files being spliced, innermost last */
+  char **stack;
+  pthread_mutex_t lock;
+  ThreadGroup group;
+};
+
 typedef struct Parser {
+  const char *source;
   Token *tokens;
   u64 current_token;
+  /* canonical path of the file the tokens came from, imports resolve
+   * against its directory. null for a source string, which resolves them
+   * against the working one */
+  char *path;
+  ParserModules *modules;
+  /* an import parser shares the modules of its importer */
+  b8 owns_modules;
+  /* import statements met so far */
+  ParserImport *imports;
+  ParserBody **bodies;
+  /* identifiers and string literals of the tree, tokens hold no copies */
+  char **strings;
+  /* a stream lexes as it parses, its tokens are the statement at hand */
+  b8 stream;
+  Lexer lexer;
+  /* statements that ran and are still referred to, with their strings */
+  ASTNode *retained;
+  char **kept;
 } Parser;
 
-void parserCreate(Token *tokens, Parser *out_parser);
+void parserCreate(Token *tokens, const char *path, Parser *out_parser);
 void parserDestroy(Parser *parser);
 
-ASTNode parserBuildAST(Parser *parser);
\ No newline at end of file
+/* parses the program and every module it imports */
+ASTNode parserBuildAST(Parser *parser);
+
+/* a parser handing out one top-level statement at a time, so a script
+ * never has to be held whole. function bodies are parsed eagerly */
+void parserCreateStream(const char *source, u64 length, const char *path,
+                        Parser *out_parser);
+/* false at the end of the source. an import comes out as a PROGRAMM node
+ * of its module's statements */
+b8 parserNextStatement(Parser *parser, ASTNode *out_statement);
+/* frees a statement that ran and its tokens. a definition, a spawn or a
+ * declared name the scope still refers to is kept with the parser */
+void parserStatementRelease(Parser *parser, ASTNode *statement);
+
+/* a body that is lexed and parsed from its text on the first call */
+ParserBody *parserBodyCreate(const char *source, u64 length, u32 line,
+                             b8 yields);
+void parserBodyDestroy(ParserBody *body);
+
+/* block of a function body, parsed by the first caller. threads calling
+ * it together wait for that one, a syntax error raises on every call */
+ASTNode *parserBodyBlock(ParserBody *body);
\ No newline at end of file
@@ -0,0 +1,522 @@
+#include "server.h"
+
+#include "file_io.h"
+#include "liv.h"
+#include "logger.h"
+#include "vector.h"
+
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_PROTOCOL_VERSION 1
+#define SERVER_BACKLOG 64
+/* stdin, stdout and stderr of the client */
+#define SERVER_FD_COUNT 3
+/* bound on the strings of a request, the size is sent by the client */
+#define SERVER_MAX_SIZE (1ull << 30)
+
+typedef enum ServerRequestKind {
+  SERVER_REQUEST_KIND_PATH,
+  SERVER_REQUEST_KIND_SOURCE,
+} ServerRequestKind;
+
+/* sent first, along with the client's descriptors. size bytes of strings
+ * follow: the working directory, the script path or source, then the
+ * script arguments, each NUL terminated */
+typedef struct ServerHeader {
+  u32 version;
+  u32 kind;
+  u32 count;
+  u32 size;
+} ServerHeader;
+
+typedef struct ServerRequest {
+  ServerHeader header;
+  i32 fds[SERVER_FD_COUNT];
+  char *strings;
+  /* count pointers into strings */
+  char **fields;
+} ServerRequest;
+
+/* the state of a file when a program was parsed from it */
+typedef struct ServerFile {
+  char *path;
+  struct timespec mtime;
+  i64 size;
+} ServerFile;
+
+/* a parsed script. files holds the script first, then the files it
+ * imports */
+typedef struct ServerEntry {
+  char *path;
+  ServerFile *files;
+  LivProgram *program;
+} ServerEntry;
+
+static b8 serverReceive(i32 conn, ServerRequest *out_request);
+static void serverRequestDestroy(ServerRequest *request);
+static LivProgram *serverProgram(ServerEntry **cache, const char *path,
+                                 Error *out_error);
+static b8 serverResolve(const char *cwd, const char *path, char *out_path);
+static b8 serverStat(const char *path, ServerFile *out_file);
+static b8 serverFresh(ServerEntry *entry);
+static void serverFilesDestroy(ServerFile *files);
+static void serverExecute(i32 conn, ServerRequest *request,
+                          LivProgram *program, Error *error);
+static i32 serverSocket(const char *socket_path, struct sockaddr_un *address);
+static b8 serverReadAll(i32 fd, void *data, u64 size);
+static b8 serverWriteAll(i32 fd, const void *data, u64 size);
+
+b8 serverRun(const char *socket_path) {
+  struct sockaddr_un address;
+  i32 listener = serverSocket(socket_path, &address);
+  if (listener < 0) {
+    return false;
+  }
+
+  unlink(socket_path);
+  if (bind(listener, (struct sockaddr *)&address, sizeof(address)) ||
+      listen(listener, SERVER_BACKLOG)) {
+    close(listener);
+    return false;
+  }
+
+  /* finished requests are reaped by the kernel, a client that went away
+   * must not kill the server */
+  signal(SIGCHLD, SIG_IGN);
+  signal(SIGPIPE, SIG_IGN);
+
+  ServerEntry *cache = vectorCreate(ServerEntry);
+
+  for (;;) {
+    i32 conn = accept(listener, 0, 0);
+    if (conn < 0) {
+      continue;
+    }
+
+    ServerRequest request;
+    if (!serverReceive(conn, &request)) {
+      close(conn);
+      continue;
+    }
+
+    Error error = {};
+    LivProgram *program = 0;
+    if (request.header.kind == SERVER_REQUEST_KIND_PATH) {
+      char path[PATH_MAX];
+      if (serverResolve(request.fields[0], request.fields[1], path)) {
+        program = serverProgram(&cache, path, &error);
+      } else {
+        error.line = 0;
+        snprintf(error.message, ERROR_MESSAGE_LENGTH,
+                 "liv: failed to read a file %s!", request.fields[1]);
+      }
+    }
+
+    /* the child starts with the cached programs already parsed */
+    fflush(stdout);
+    fflush(stderr);
+    if (fork() == 0) {
+      close(listener);
+      serverExecute(conn, &request, program, &error);
+    }
+
+    serverRequestDestroy(&request);
+    close(conn);
+  }
+
+  return true;
+}
+
+b8 serverConnect(const char *socket_path, const char *script, u32 argc,
+                 char **argv, i32 *out_status) {
+  struct sockaddr_un address;
+  i32 conn = serverSocket(socket_path, &address);
+  if (conn < 0) {
+    return false;
+  }
+
+  if (connect(conn, (struct sockaddr *)&address, sizeof(address))) {
+    close(conn);
+    return false;
+  }
+
+  ServerHeader header = {};
+  header.version = SERVER_PROTOCOL_VERSION;
+  header.count = argc + 2;
+
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd))) {
+    cwd[0] = 0;
+  }
+
+  /* the cache is keyed by the full path */
+  char resolved[PATH_MAX];
+  FileView source = {};
+  const char *payload = 0;
+  u64 payload_length = 0;
+  if (!strcmp(script, "-")) {
+    header.kind = SERVER_REQUEST_KIND_SOURCE;
+    if (!fileViewRead(STDIN_FILENO, &source)) {
+      FATAL("liv: failed to read the script from stdin!");
+      close(conn);
+      *out_status = 1;
+      return true;
+    }
+    payload = source.data;
+    payload_length = source.length;
+  } else {
+    header.kind = SERVER_REQUEST_KIND_PATH;
+    payload = realpath(script, resolved) ? resolved : (char *)script;
+    payload_length = strlen(payload);
+  }
+
+  u64 cwd_length = strlen(cwd);
+  u64 size = cwd_length + 1 + payload_length + 1;
+  for (u32 i = 0; i < argc; ++i) {
+    size += strlen(argv[i]) + 1;
+  }
+  if (size > SERVER_MAX_SIZE) {
+    FATAL("liv: the script is too large to send to the server!");
+    if (header.kind == SERVER_REQUEST_KIND_SOURCE) {
+      fileViewClose(&source);
+    }
+    close(conn);
+    *out_status = 1;
+    return true;
+  }
+  header.size = size;
+
+  char *strings = malloc(size);
+  char *cursor = strings;
+  memcpy(cursor, cwd, cwd_length + 1);
+  cursor += cwd_length + 1;
+  memcpy(cursor, payload, payload_length);
+  cursor[payload_length] = 0;
+  cursor += payload_length + 1;
+  for (u32 i = 0; i < argc; ++i) {
+    u64 length = strlen(argv[i]);
+    memcpy(cursor, argv[i], length + 1);
+    cursor += length + 1;
+  }
+
+  if (header.kind == SERVER_REQUEST_KIND_SOURCE) {
+    fileViewClose(&source);
+  }
+
+  /* the descriptors travel with the header, so the script writes straight
+   * to wherever this process's output goes */
+  i32 fds[SERVER_FD_COUNT] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  union {
+    char data[CMSG_SPACE(sizeof(fds))];
+    struct cmsghdr align;
+  } control = {};
+
+  struct iovec io = {&header, sizeof(header)};
+  struct msghdr message = {};
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  /* stdout is handed over, anything buffered here goes first */
+  fflush(stdout);
+  fflush(stderr);
+
+  b8 sent = sendmsg(conn, &message, 0) == sizeof(header) &&
+            serverWriteAll(conn, strings, size);
+  free(strings);
+
+  i32 status = 1;
+  if (!sent || !serverReadAll(conn, &status, sizeof(status))) {
+    FATAL("liv: the server dropped the request!");
+    status = 1;
+  }
+
+  close(conn);
+  *out_status = status;
+
+  return true;
+}
+
+static b8 serverReceive(i32 conn, ServerRequest *out_request) {
+  union {
+    char data[CMSG_SPACE(sizeof(i32) * SERVER_FD_COUNT)];
+    struct cmsghdr align;
+  } control = {};
+
+  struct iovec io = {&out_request->header, sizeof(ServerHeader)};
+  struct msghdr message = {};
+  message.msg_iov = &io;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  if (recvmsg(conn, &message, MSG_WAITALL) != sizeof(ServerHeader)) {
+    return false;
+  }
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(i32) * SERVER_FD_COUNT)) {
+    return false;
+  }
+  memcpy(out_request->fds, CMSG_DATA(cmsg), sizeof(i32) * SERVER_FD_COUNT);
+
+  ServerHeader *header = &out_request->header;
+  out_request->strings = 0;
+  out_request->fields = 0;
+  /* every field takes at least its terminator */
+  if (header->version != SERVER_PROTOCOL_VERSION || header->count < 2 ||
+      header->size > SERVER_MAX_SIZE || header->count > header->size) {
+    serverRequestDestroy(out_request);
+    return false;
+  }
+
+  out_request->strings = malloc((u64)header->size + 1);
+  if (!out_request->strings ||
+      !serverReadAll(conn, out_request->strings, header->size)) {
+    serverRequestDestroy(out_request);
+    return false;
+  }
+  out_request->strings[header->size] = 0;
+
+  out_request->fields = malloc(sizeof(char *) * header->count);
+  if (!out_request->fields) {
+    serverRequestDestroy(out_request);
+    return false;
+  }
+
+  char *cursor = out_request->strings;
+  char *end = out_request->strings + header->size;
+  for (u32 i = 0; i < header->count; ++i) {
+    if (cursor >= end) {
+      serverRequestDestroy(out_request);
+      return false;
+    }
+
+    out_request->fields[i] = cursor;
+    cursor += strlen(cursor) + 1;
+  }
+
+  return true;
+}
+
+static void serverRequestDestroy(ServerRequest *request) {
+  for (u32 i = 0; i < SERVER_FD_COUNT; ++i) {
+    close(request->fds[i]);
+  }
+
+  free(request->strings);
+  free(request->fields);
+}
+
+/* the cached program for path, parsed again when the script or one of the
+ * files it imports has changed */
+static LivProgram *serverProgram(ServerEntry **cache, const char *path,
+                                 Error *out_error) {
+  ServerEntry *entries = *cache;
+  ServerEntry *entry = 0;
+  for (u32 i = 0; i < vectorLength(entries); ++i) {
+    if (!strcmp(entries[i].path, path)) {
+      entry = &entries[i];
+      break;
+    }
+  }
+
+  if (entry && entry->program && serverFresh(entry)) {
+    return entry->program;
+  }
+
+  /* forks still running the old program have their own copy */
+  if (entry && entry->program) {
+    livProgramDestroy(entry->program);
+    serverFilesDestroy(entry->files);
+    entry->program = 0;
+    entry->files = 0;
+  }
+
+  /* taken before parsing, a change made meanwhile is seen next time */
+  ServerFile script;
+  if (!serverStat(path, &script)) {
+    out_error->line = 0;
+    snprintf(out_error->message, ERROR_MESSAGE_LENGTH,
+             "liv: failed to read a file %s!", path);
+    return 0;
+  }
+
+  LivProgram *program = livParseFile(path, out_error);
+  if (!program) {
+    free(script.path);
+    return 0;
+  }
+
+  ServerFile *files = vectorCreate(ServerFile);
+  vectorPush(files, script);
+
+  /* an import that cannot be read is checked again, and found stale, on the
+   * next request */
+  char **imports = livProgramImports(program);
+  for (u32 i = 0; i < vectorLength(imports); ++i) {
+    ServerFile file = {};
+    if (!serverStat(imports[i], &file)) {
+      file.path = strdup(imports[i]);
+      file.size = -1;
+    }
+    vectorPush(files, file);
+  }
+
+  if (!entry) {
+    ServerEntry added = {};
+    added.path = strdup(path);
+    vectorPush(*cache, added);
+    entry = &(*cache)[vectorLength(*cache) - 1];
+  }
+
+  entry->files = files;
+  entry->program = program;
+
+  return program;
+}
+
+/* a relative path is taken from the client's directory, the server never
+ * changes its own */
+static b8 serverResolve(const char *cwd, const char *path, char *out_path) {
+  i32 length = path[0] == '/'
+                   ? snprintf(out_path, PATH_MAX, "%s", path)
+                   : snprintf(out_path, PATH_MAX, "%s/%s", cwd, path);
+
+  return length >= 0 && length < PATH_MAX;
+}
+
+static b8 serverStat(const char *path, ServerFile *out_file) {
+  struct stat info;
+  if (stat(path, &info)) {
+    return false;
+  }
+
+  out_file->path = strdup(path);
+  out_file->mtime = info.st_mtim;
+  out_file->size = info.st_size;
+
+  return true;
+}
+
+static b8 serverFresh(ServerEntry *entry) {
+  for (u32 i = 0; i < vectorLength(entry->files); ++i) {
+    ServerFile *file = &entry->files[i];
+
+    struct stat info;
+    if (stat(file->path, &info) || file->size != info.st_size ||
+        file->mtime.tv_sec != info.st_mtim.tv_sec ||
+        file->mtime.tv_nsec != info.st_mtim.tv_nsec) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void serverFilesDestroy(ServerFile *files) {
+  for (u32 i = 0; i < vectorLength(files); ++i) {
+    free(files[i].path);
+  }
+  vectorDestroy(files);
+}
+
+/* runs in the forked child and never returns. the exit status is sent back
+ * once the output is flushed */
+static void serverExecute(i32 conn, ServerRequest *request,
+                          LivProgram *program, Error *error) {
+  for (u32 i = 0; i < SERVER_FD_COUNT; ++i) {
+    dup2(request->fds[i], i);
+    close(request->fds[i]);
+  }
+
+  /* the script runs in the client's directory, a source string also
+   * resolves its imports against it */
+  if (request->fields[0][0] && chdir(request->fields[0])) {
+    program = 0;
+    error->line = 0;
+    snprintf(error->message, ERROR_MESSAGE_LENGTH,
+             "liv: failed to enter the directory %s!", request->fields[0]);
+  } else if (request->header.kind == SERVER_REQUEST_KIND_SOURCE) {
+    program = livParse(request->fields[1], error);
+  }
+
+  i32 status = 1;
+  if (!program) {
+    errorLog(error);
+  } else {
+    LivVM *vm = livCreate();
+    livSet(vm, "args",
+           livStringArray(&request->fields[2], request->header.count - 2));
+
+    if (livRun(vm, program)) {
+      status = 0;
+    } else {
+      errorLog(livError(vm));
+    }
+  }
+
+  fflush(stdout);
+  fflush(stderr);
+  serverWriteAll(conn, &status, sizeof(status));
+
+  _exit(status);
+}
+
+static i32 serverSocket(const char *socket_path, struct sockaddr_un *address) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address->sun_path)) {
+    return -1;
+  }
+  strcpy(address->sun_path, socket_path);
+
+  return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+static b8 serverReadAll(i32 fd, void *data, u64 size) {
+  char *cursor = data;
+  while (size > 0) {
+    i64 count = read(fd, cursor, size);
+    if (count <= 0) {
+      return false;
+    }
+
+    cursor += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+static b8 serverWriteAll(i32 fd, const void *data, u64 size) {
+  const char *cursor = data;
+  while (size > 0) {
+    i64 count = write(fd, cursor, size);
+    if (count <= 0) {
+      return false;
+    }
+
+    cursor += count;
+    size -= count;
+  }
+
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "defines.h"
+
+/* keeps an interpreter warm behind a unix socket. scripts are parsed once
+ * and cached until their file changes, every request runs in a fork of the
+ * server with its own vm, writing to the client's stdin, stdout and stderr.
+ * returns only if the socket cannot be set up */
+b8 serverRun(const char *socket_path);
+
+/* runs a script through the server at socket_path, "-" sends the source
+ * read from stdin. false if no server is listening there */
+b8 serverConnect(const char *socket_path, const char *script, u32 argc,
+                 char **argv, i32 *out_status);
\ No newline at end of file
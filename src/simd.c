@@ -0,0 +1,1197 @@
+#include "simd.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+typedef i64 (*SimdFindFun)(const char *, u64, const char *, u64);
+
+static i64 simdFindResolve(const char *haystack, u64 length,
+                           const char *needle, u64 needle_length);
+static i64 simdFindScalar(const char *haystack, u64 length,
+                          const char *needle, u64 needle_length);
+#ifdef SIMD_X86
+static i64 simdFindSse2(const char *haystack, u64 length, const char *needle,
+                        u64 needle_length);
+static i64 simdFindAvx2(const char *haystack, u64 length, const char *needle,
+                        u64 needle_length);
+#endif
+
+/* the text kernels are resolved together as well */
+typedef struct SimdText {
+  u64 (*span_space)(const char *s, u64 length, u64 *out_lines);
+  u64 (*span_ident)(const char *s, u64 length);
+  u64 (*span_until)(const char *s, u64 length, char a, char b,
+                    u64 *out_lines);
+} SimdText;
+
+static const SimdText *simdText();
+
+static u64 simdSpanSpaceScalar(const char *s, u64 length, u64 *out_lines);
+static u64 simdSpanIdentScalar(const char *s, u64 length);
+static u64 simdSpanUntilScalar(const char *s, u64 length, char a, char b,
+                               u64 *out_lines);
+#ifdef SIMD_X86
+static u64 simdSpanSpaceSse2(const char *s, u64 length, u64 *out_lines);
+static u64 simdSpanIdentSse2(const char *s, u64 length);
+static u64 simdSpanUntilSse2(const char *s, u64 length, char a, char b,
+                             u64 *out_lines);
+static u64 simdSpanSpaceAvx2(const char *s, u64 length, u64 *out_lines);
+static u64 simdSpanIdentAvx2(const char *s, u64 length);
+static u64 simdSpanUntilAvx2(const char *s, u64 length, char a, char b,
+                             u64 *out_lines);
+#endif
+
+/* the numeric kernels are resolved together as one table */
+typedef struct SimdNumeric {
+  f64 (*sum_f64)(const f64 *x, u64 n);
+  i64 (*sum_i64)(const i64 *x, u64 n);
+  f64 (*min_f64)(const f64 *x, u64 n);
+  f64 (*max_f64)(const f64 *x, u64 n);
+  i64 (*min_i64)(const i64 *x, u64 n);
+  i64 (*max_i64)(const i64 *x, u64 n);
+  f64 (*dot_f64)(const f64 *x, const f64 *y, u64 n);
+  void (*fill_64)(void *x, u64 bits, u64 n);
+  void (*scale_f64)(f64 *x, f64 a, u64 n);
+  void (*axpy_f64)(f64 *y, f64 a, const f64 *x, u64 n);
+  void (*add_f64)(f64 *out, const f64 *x, const f64 *y, u64 n);
+  void (*mul_f64)(f64 *out, const f64 *x, const f64 *y, u64 n);
+  void (*add_i64)(i64 *out, const i64 *x, const i64 *y, u64 n);
+  void (*prefix_sum_f64)(f64 *out, const f64 *x, u64 n);
+  void (*prefix_sum_i64)(i64 *out, const i64 *x, u64 n);
+} SimdNumeric;
+
+static const SimdNumeric *simdNumeric();
+
+static f64 simdSumF64Scalar(const f64 *x, u64 n);
+static i64 simdSumI64Scalar(const i64 *x, u64 n);
+static f64 simdMinF64Scalar(const f64 *x, u64 n);
+static f64 simdMaxF64Scalar(const f64 *x, u64 n);
+static i64 simdMinI64Scalar(const i64 *x, u64 n);
+static i64 simdMaxI64Scalar(const i64 *x, u64 n);
+static f64 simdDotF64Scalar(const f64 *x, const f64 *y, u64 n);
+static void simdFill64Scalar(void *x, u64 bits, u64 n);
+static void simdScaleF64Scalar(f64 *x, f64 a, u64 n);
+static void simdAxpyF64Scalar(f64 *y, f64 a, const f64 *x, u64 n);
+static void simdAddF64Scalar(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdMulF64Scalar(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdAddI64Scalar(i64 *out, const i64 *x, const i64 *y, u64 n);
+static void simdPrefixSumF64Scalar(f64 *out, const f64 *x, u64 n);
+static void simdPrefixSumI64Scalar(i64 *out, const i64 *x, u64 n);
+
+#ifdef SIMD_X86
+static f64 simdSumF64Sse2(const f64 *x, u64 n);
+static i64 simdSumI64Sse2(const i64 *x, u64 n);
+static f64 simdMinF64Sse2(const f64 *x, u64 n);
+static f64 simdMaxF64Sse2(const f64 *x, u64 n);
+static f64 simdDotF64Sse2(const f64 *x, const f64 *y, u64 n);
+static void simdFill64Sse2(void *x, u64 bits, u64 n);
+static void simdScaleF64Sse2(f64 *x, f64 a, u64 n);
+static void simdAxpyF64Sse2(f64 *y, f64 a, const f64 *x, u64 n);
+static void simdAddF64Sse2(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdMulF64Sse2(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdAddI64Sse2(i64 *out, const i64 *x, const i64 *y, u64 n);
+static void simdPrefixSumF64Sse2(f64 *out, const f64 *x, u64 n);
+static void simdPrefixSumI64Sse2(i64 *out, const i64 *x, u64 n);
+
+static f64 simdSumF64Avx2(const f64 *x, u64 n);
+static i64 simdSumI64Avx2(const i64 *x, u64 n);
+static f64 simdMinF64Avx2(const f64 *x, u64 n);
+static f64 simdMaxF64Avx2(const f64 *x, u64 n);
+static i64 simdMinI64Avx2(const i64 *x, u64 n);
+static i64 simdMaxI64Avx2(const i64 *x, u64 n);
+static f64 simdDotF64Avx2(const f64 *x, const f64 *y, u64 n);
+static void simdFill64Avx2(void *x, u64 bits, u64 n);
+static void simdScaleF64Avx2(f64 *x, f64 a, u64 n);
+static void simdAxpyF64Avx2(f64 *y, f64 a, const f64 *x, u64 n);
+static void simdAddF64Avx2(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdMulF64Avx2(f64 *out, const f64 *x, const f64 *y, u64 n);
+static void simdAddI64Avx2(i64 *out, const i64 *x, const i64 *y, u64 n);
+static void simdPrefixSumF64Avx2(f64 *out, const f64 *x, u64 n);
+static void simdPrefixSumI64Avx2(i64 *out, const i64 *x, u64 n);
+#endif
+
+/* the first call replaces the resolver with the best kernel, racing threads
+ * store the same pointer */
+static SimdFindFun simd_find = simdFindResolve;
+
+static const SimdNumeric simd_numeric_scalar = {
+    simdSumF64Scalar,       simdSumI64Scalar,       simdMinF64Scalar,
+    simdMaxF64Scalar,       simdMinI64Scalar,       simdMaxI64Scalar,
+    simdDotF64Scalar,       simdFill64Scalar,       simdScaleF64Scalar,
+    simdAxpyF64Scalar,      simdAddF64Scalar,       simdMulF64Scalar,
+    simdAddI64Scalar,       simdPrefixSumF64Scalar, simdPrefixSumI64Scalar,
+};
+
+#ifdef SIMD_X86
+/* sse2 has no 64-bit integer compare, min and max stay scalar */
+static const SimdNumeric simd_numeric_sse2 = {
+    simdSumF64Sse2,       simdSumI64Sse2,       simdMinF64Sse2,
+    simdMaxF64Sse2,       simdMinI64Scalar,     simdMaxI64Scalar,
+    simdDotF64Sse2,       simdFill64Sse2,       simdScaleF64Sse2,
+    simdAxpyF64Sse2,      simdAddF64Sse2,       simdMulF64Sse2,
+    simdAddI64Sse2,       simdPrefixSumF64Sse2, simdPrefixSumI64Sse2,
+};
+
+static const SimdNumeric simd_numeric_avx2 = {
+    simdSumF64Avx2,       simdSumI64Avx2,       simdMinF64Avx2,
+    simdMaxF64Avx2,       simdMinI64Avx2,       simdMaxI64Avx2,
+    simdDotF64Avx2,       simdFill64Avx2,       simdScaleF64Avx2,
+    simdAxpyF64Avx2,      simdAddF64Avx2,       simdMulF64Avx2,
+    simdAddI64Avx2,       simdPrefixSumF64Avx2, simdPrefixSumI64Avx2,
+};
+#endif
+
+static const SimdNumeric *simd_numeric = 0;
+
+static const SimdText simd_text_scalar = {
+    simdSpanSpaceScalar,
+    simdSpanIdentScalar,
+    simdSpanUntilScalar,
+};
+
+#ifdef SIMD_X86
+static const SimdText simd_text_sse2 = {
+    simdSpanSpaceSse2,
+    simdSpanIdentSse2,
+    simdSpanUntilSse2,
+};
+
+static const SimdText simd_text_avx2 = {
+    simdSpanSpaceAvx2,
+    simdSpanIdentAvx2,
+    simdSpanUntilAvx2,
+};
+#endif
+
+static const SimdText *simd_text = 0;
+
+i64 simdFind(const char *haystack, u64 length, const char *needle,
+             u64 needle_length) {
+  if (needle_length == 0) {
+    return 0;
+  }
+  if (needle_length > length) {
+    return -1;
+  }
+
+  return simd_find(haystack, length, needle, needle_length);
+}
+
+u64 simdSpanSpace(const char *s, u64 length, u64 *out_lines) {
+  return simdText()->span_space(s, length, out_lines);
+}
+
+u64 simdSpanIdent(const char *s, u64 length) {
+  return simdText()->span_ident(s, length);
+}
+
+u64 simdSpanUntil(const char *s, u64 length, char a, char b,
+                  u64 *out_lines) {
+  return simdText()->span_until(s, length, a, b, out_lines);
+}
+
+f64 simdSumF64(const f64 *x, u64 n) { return simdNumeric()->sum_f64(x, n); }
+
+i64 simdSumI64(const i64 *x, u64 n) { return simdNumeric()->sum_i64(x, n); }
+
+f64 simdMinF64(const f64 *x, u64 n) { return simdNumeric()->min_f64(x, n); }
+
+f64 simdMaxF64(const f64 *x, u64 n) { return simdNumeric()->max_f64(x, n); }
+
+i64 simdMinI64(const i64 *x, u64 n) { return simdNumeric()->min_i64(x, n); }
+
+i64 simdMaxI64(const i64 *x, u64 n) { return simdNumeric()->max_i64(x, n); }
+
+f64 simdDotF64(const f64 *x, const f64 *y, u64 n) {
+  return simdNumeric()->dot_f64(x, y, n);
+}
+
+void simdFill64(void *x, u64 bits, u64 n) {
+  simdNumeric()->fill_64(x, bits, n);
+}
+
+void simdScaleF64(f64 *x, f64 a, u64 n) { simdNumeric()->scale_f64(x, a, n); }
+
+void simdAxpyF64(f64 *y, f64 a, const f64 *x, u64 n) {
+  simdNumeric()->axpy_f64(y, a, x, n);
+}
+
+void simdAddF64(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  simdNumeric()->add_f64(out, x, y, n);
+}
+
+void simdMulF64(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  simdNumeric()->mul_f64(out, x, y, n);
+}
+
+void simdAddI64(i64 *out, const i64 *x, const i64 *y, u64 n) {
+  simdNumeric()->add_i64(out, x, y, n);
+}
+
+void simdPrefixSumF64(f64 *out, const f64 *x, u64 n) {
+  simdNumeric()->prefix_sum_f64(out, x, n);
+}
+
+void simdPrefixSumI64(i64 *out, const i64 *x, u64 n) {
+  simdNumeric()->prefix_sum_i64(out, x, n);
+}
+
+static const SimdNumeric *simdNumeric() {
+  const SimdNumeric *numeric = __atomic_load_n(&simd_numeric, __ATOMIC_RELAXED);
+  if (numeric) {
+    return numeric;
+  }
+
+  numeric = &simd_numeric_scalar;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    numeric = &simd_numeric_avx2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    numeric = &simd_numeric_sse2;
+  }
+#endif
+
+  __atomic_store_n(&simd_numeric, numeric, __ATOMIC_RELAXED);
+
+  return numeric;
+}
+
+static const SimdText *simdText() {
+  const SimdText *text = __atomic_load_n(&simd_text, __ATOMIC_RELAXED);
+  if (text) {
+    return text;
+  }
+
+  text = &simd_text_scalar;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    text = &simd_text_avx2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    text = &simd_text_sse2;
+  }
+#endif
+
+  __atomic_store_n(&simd_text, text, __ATOMIC_RELAXED);
+
+  return text;
+}
+
+static i64 simdFindResolve(const char *haystack, u64 length,
+                           const char *needle, u64 needle_length) {
+  SimdFindFun find = simdFindScalar;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    find = simdFindAvx2;
+  } else if (__builtin_cpu_supports("sse2")) {
+    find = simdFindSse2;
+  }
+#endif
+
+  __atomic_store_n(&simd_find, find, __ATOMIC_RELAXED);
+
+  return find(haystack, length, needle, needle_length);
+}
+
+static i64 simdFindScalar(const char *haystack, u64 length,
+                          const char *needle, u64 needle_length) {
+  if (needle_length > length) {
+    return -1;
+  }
+
+  const char *end = haystack + length - needle_length + 1;
+  const char *p = haystack;
+
+  while (p < end) {
+    p = memchr(p, needle[0], end - p);
+    if (!p) {
+      return -1;
+    }
+    if (!memcmp(p + 1, needle + 1, needle_length - 1)) {
+      return p - haystack;
+    }
+
+    p++;
+  }
+
+  return -1;
+}
+
+#ifdef SIMD_X86
+/* candidates are positions where both the first and the last byte of the
+ * needle match, only those are verified with memcmp */
+static i64 simdFindSse2(const char *haystack, u64 length, const char *needle,
+                        u64 needle_length) {
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+
+  u64 i = 0;
+  for (; i + needle_length - 1 + 16 <= length; i += 16) {
+    __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+    __m128i block_last = _mm_loadu_si128(
+        (const __m128i *)(haystack + i + needle_length - 1));
+
+    u32 mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+
+    while (mask) {
+      u32 bit = __builtin_ctz(mask);
+      if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 1)) {
+        return i + bit;
+      }
+
+      mask &= mask - 1;
+    }
+  }
+
+  i64 rest = simdFindScalar(haystack + i, length - i, needle, needle_length);
+
+  return rest < 0 ? -1 : (i64)i + rest;
+}
+
+__attribute__((target("avx2"))) static i64
+simdFindAvx2(const char *haystack, u64 length, const char *needle,
+             u64 needle_length) {
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+  u64 i = 0;
+  for (; i + needle_length - 1 + 32 <= length; i += 32) {
+    __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+    __m256i block_last = _mm256_loadu_si256(
+        (const __m256i *)(haystack + i + needle_length - 1));
+
+    u32 mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first),
+                         _mm256_cmpeq_epi8(block_last, last)));
+
+    while (mask) {
+      u32 bit = __builtin_ctz(mask);
+      if (!memcmp(haystack + i + bit + 1, needle + 1, needle_length - 1)) {
+        return i + bit;
+      }
+
+      mask &= mask - 1;
+    }
+  }
+
+  i64 rest = simdFindSse2(haystack + i, length - i, needle, needle_length);
+
+  return rest < 0 ? -1 : (i64)i + rest;
+}
+#endif
+
+static u64 simdSpanSpaceScalar(const char *s, u64 length, u64 *out_lines) {
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i < length; ++i) {
+    char c = s[i];
+    if (c == '\n') {
+      lines++;
+    } else if (c != ' ' && c != '\t' && c != '\r' && c != '\f') {
+      break;
+    }
+  }
+
+  *out_lines = lines;
+  return i;
+}
+
+static u64 simdSpanIdentScalar(const char *s, u64 length) {
+  u64 i = 0;
+  for (; i < length; ++i) {
+    char c = s[i];
+    char lower = c | 0x20;
+    if (!(lower >= 'a' && lower <= 'z') && !(c >= '0' && c <= '9') &&
+        c != '_') {
+      break;
+    }
+  }
+
+  return i;
+}
+
+static u64 simdSpanUntilScalar(const char *s, u64 length, char a, char b,
+                               u64 *out_lines) {
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i < length && s[i] != a && s[i] != b; ++i) {
+    lines += s[i] == '\n';
+  }
+
+  *out_lines = lines;
+  return i;
+}
+
+#ifdef SIMD_X86
+/* every kernel builds a mask of the bytes that end the run, the first set
+ * bit is where it stops. newlines before it are counted from their own
+ * mask. blocks past the end are not loaded, the scalar kernel finishes */
+static u64 simdSpanSpaceSse2(const char *s, u64 length, u64 *out_lines) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i carriage = _mm_set1_epi8('\r');
+  const __m128i feed = _mm_set1_epi8('\f');
+
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i newlines = _mm_cmpeq_epi8(block, newline);
+    __m128i blanks = _mm_or_si128(
+        _mm_or_si128(newlines, _mm_cmpeq_epi8(block, space)),
+        _mm_or_si128(_mm_cmpeq_epi8(block, tab),
+                     _mm_or_si128(_mm_cmpeq_epi8(block, carriage),
+                                  _mm_cmpeq_epi8(block, feed))));
+
+    u32 line_mask = _mm_movemask_epi8(newlines);
+    u32 stop = ~_mm_movemask_epi8(blanks) & 0xffff;
+    if (stop) {
+      u32 end = __builtin_ctz(stop);
+      *out_lines = lines + __builtin_popcount(line_mask & ((1u << end) - 1));
+      return i + end;
+    }
+    lines += __builtin_popcount(line_mask);
+  }
+
+  u64 rest_lines;
+  u64 rest = simdSpanSpaceScalar(s + i, length - i, &rest_lines);
+  *out_lines = lines + rest_lines;
+
+  return i + rest;
+}
+
+/* bytes are compared signed, so anything past ascii is below every range */
+static u64 simdSpanIdentSse2(const char *s, u64 length) {
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+  const __m128i before_a = _mm_set1_epi8('a' - 1);
+  const __m128i after_z = _mm_set1_epi8('z' + 1);
+  const __m128i before_0 = _mm_set1_epi8('0' - 1);
+  const __m128i after_9 = _mm_set1_epi8('9' + 1);
+  const __m128i underscore = _mm_set1_epi8('_');
+
+  u64 i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+    __m128i lower = _mm_or_si128(block, case_bit);
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(lower, before_a),
+                                    _mm_cmplt_epi8(lower, after_z));
+    __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(block, before_0),
+                                   _mm_cmplt_epi8(block, after_9));
+    __m128i ident = _mm_or_si128(_mm_or_si128(letters, digits),
+                                 _mm_cmpeq_epi8(block, underscore));
+
+    u32 stop = ~_mm_movemask_epi8(ident) & 0xffff;
+    if (stop) {
+      return i + __builtin_ctz(stop);
+    }
+  }
+
+  return i + simdSpanIdentScalar(s + i, length - i);
+}
+
+static u64 simdSpanUntilSse2(const char *s, u64 length, char a, char b,
+                             u64 *out_lines) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i first = _mm_set1_epi8(a);
+  const __m128i second = _mm_set1_epi8(b);
+
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(s + i));
+
+    u32 line_mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+    u32 stop = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(block, first), _mm_cmpeq_epi8(block, second)));
+    if (stop) {
+      u32 end = __builtin_ctz(stop);
+      *out_lines = lines + __builtin_popcount(line_mask & ((1u << end) - 1));
+      return i + end;
+    }
+    lines += __builtin_popcount(line_mask);
+  }
+
+  u64 rest_lines;
+  u64 rest = simdSpanUntilScalar(s + i, length - i, a, b, &rest_lines);
+  *out_lines = lines + rest_lines;
+
+  return i + rest;
+}
+
+__attribute__((target("avx2"))) static u64
+simdSpanSpaceAvx2(const char *s, u64 length, u64 *out_lines) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i carriage = _mm256_set1_epi8('\r');
+  const __m256i feed = _mm256_set1_epi8('\f');
+
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i newlines = _mm256_cmpeq_epi8(block, newline);
+    __m256i blanks = _mm256_or_si256(
+        _mm256_or_si256(newlines, _mm256_cmpeq_epi8(block, space)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, tab),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(block, carriage),
+                                        _mm256_cmpeq_epi8(block, feed))));
+
+    u32 line_mask = _mm256_movemask_epi8(newlines);
+    u32 stop = ~(u32)_mm256_movemask_epi8(blanks);
+    if (stop) {
+      u32 end = __builtin_ctz(stop);
+      *out_lines = lines + __builtin_popcount(line_mask & ((1u << end) - 1));
+      return i + end;
+    }
+    lines += __builtin_popcount(line_mask);
+  }
+
+  u64 rest_lines;
+  u64 rest = simdSpanSpaceSse2(s + i, length - i, &rest_lines);
+  *out_lines = lines + rest_lines;
+
+  return i + rest;
+}
+
+__attribute__((target("avx2"))) static u64
+simdSpanIdentAvx2(const char *s, u64 length) {
+  const __m256i case_bit = _mm256_set1_epi8(0x20);
+  const __m256i before_a = _mm256_set1_epi8('a' - 1);
+  const __m256i after_z = _mm256_set1_epi8('z' + 1);
+  const __m256i before_0 = _mm256_set1_epi8('0' - 1);
+  const __m256i after_9 = _mm256_set1_epi8('9' + 1);
+  const __m256i underscore = _mm256_set1_epi8('_');
+
+  u64 i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(s + i));
+    __m256i lower = _mm256_or_si256(block, case_bit);
+    __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(lower, before_a),
+                                       _mm256_cmpgt_epi8(after_z, lower));
+    __m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(block, before_0),
+                                      _mm256_cmpgt_epi8(after_9, block));
+    __m256i ident = _mm256_or_si256(_mm256_or_si256(letters, digits),
+                                    _mm256_cmpeq_epi8(block, underscore));
+
+    u32 stop = ~(u32)_mm256_movemask_epi8(ident);
+    if (stop) {
+      return i + __builtin_ctz(stop);
+    }
+  }
+
+  return i + simdSpanIdentSse2(s + i, length - i);
+}
+
+__attribute__((target("avx2"))) static u64
+simdSpanUntilAvx2(const char *s, u64 length, char a, char b,
+                  u64 *out_lines) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i first = _mm256_set1_epi8(a);
+  const __m256i second = _mm256_set1_epi8(b);
+
+  u64 lines = 0;
+  u64 i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(s + i));
+
+    u32 line_mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline));
+    u32 stop = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(block, first), _mm256_cmpeq_epi8(block, second)));
+    if (stop) {
+      u32 end = __builtin_ctz(stop);
+      *out_lines = lines + __builtin_popcount(line_mask & ((1u << end) - 1));
+      return i + end;
+    }
+    lines += __builtin_popcount(line_mask);
+  }
+
+  u64 rest_lines;
+  u64 rest = simdSpanUntilSse2(s + i, length - i, a, b, &rest_lines);
+  *out_lines = lines + rest_lines;
+
+  return i + rest;
+}
+#endif
+
+static f64 simdSumF64Scalar(const f64 *x, u64 n) {
+  f64 sum = 0;
+  for (u64 i = 0; i < n; ++i) {
+    sum += x[i];
+  }
+
+  return sum;
+}
+
+static i64 simdSumI64Scalar(const i64 *x, u64 n) {
+  i64 sum = 0;
+  for (u64 i = 0; i < n; ++i) {
+    sum += x[i];
+  }
+
+  return sum;
+}
+
+static f64 simdMinF64Scalar(const f64 *x, u64 n) {
+  f64 min = x[0];
+  for (u64 i = 1; i < n; ++i) {
+    min = x[i] < min ? x[i] : min;
+  }
+
+  return min;
+}
+
+static f64 simdMaxF64Scalar(const f64 *x, u64 n) {
+  f64 max = x[0];
+  for (u64 i = 1; i < n; ++i) {
+    max = x[i] > max ? x[i] : max;
+  }
+
+  return max;
+}
+
+static i64 simdMinI64Scalar(const i64 *x, u64 n) {
+  i64 min = x[0];
+  for (u64 i = 1; i < n; ++i) {
+    min = x[i] < min ? x[i] : min;
+  }
+
+  return min;
+}
+
+static i64 simdMaxI64Scalar(const i64 *x, u64 n) {
+  i64 max = x[0];
+  for (u64 i = 1; i < n; ++i) {
+    max = x[i] > max ? x[i] : max;
+  }
+
+  return max;
+}
+
+static f64 simdDotF64Scalar(const f64 *x, const f64 *y, u64 n) {
+  f64 dot = 0;
+  for (u64 i = 0; i < n; ++i) {
+    dot += x[i] * y[i];
+  }
+
+  return dot;
+}
+
+static void simdFill64Scalar(void *x, u64 bits, u64 n) {
+  u64 *p = x;
+  for (u64 i = 0; i < n; ++i) {
+    p[i] = bits;
+  }
+}
+
+static void simdScaleF64Scalar(f64 *x, f64 a, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    x[i] *= a;
+  }
+}
+
+static void simdAxpyF64Scalar(f64 *y, f64 a, const f64 *x, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    y[i] += a * x[i];
+  }
+}
+
+static void simdAddF64Scalar(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    out[i] = x[i] + y[i];
+  }
+}
+
+static void simdMulF64Scalar(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    out[i] = x[i] * y[i];
+  }
+}
+
+static void simdAddI64Scalar(i64 *out, const i64 *x, const i64 *y, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    out[i] = (i64)((u64)x[i] + (u64)y[i]);
+  }
+}
+
+static void simdPrefixSumF64Scalar(f64 *out, const f64 *x, u64 n) {
+  f64 sum = 0;
+  for (u64 i = 0; i < n; ++i) {
+    sum += x[i];
+    out[i] = sum;
+  }
+}
+
+static void simdPrefixSumI64Scalar(i64 *out, const i64 *x, u64 n) {
+  u64 sum = 0;
+  for (u64 i = 0; i < n; ++i) {
+    sum += (u64)x[i];
+    out[i] = (i64)sum;
+  }
+}
+
+#ifdef SIMD_X86
+/* two accumulators hide the latency of the vector add */
+static f64 simdSumF64Sse2(const f64 *x, u64 n) {
+  __m128d sum0 = _mm_setzero_pd();
+  __m128d sum1 = _mm_setzero_pd();
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sum0 = _mm_add_pd(sum0, _mm_loadu_pd(x + i));
+    sum1 = _mm_add_pd(sum1, _mm_loadu_pd(x + i + 2));
+  }
+
+  f64 lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+
+  return lanes[0] + lanes[1] + simdSumF64Scalar(x + i, n - i);
+}
+
+static i64 simdSumI64Sse2(const i64 *x, u64 n) {
+  __m128i sum = _mm_setzero_si128();
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    sum = _mm_add_epi64(sum, _mm_loadu_si128((const __m128i *)(x + i)));
+  }
+
+  i64 lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, sum);
+
+  return lanes[0] + lanes[1] + simdSumI64Scalar(x + i, n - i);
+}
+
+static f64 simdMinF64Sse2(const f64 *x, u64 n) {
+  __m128d min = _mm_set1_pd(x[0]);
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    min = _mm_min_pd(min, _mm_loadu_pd(x + i));
+  }
+
+  f64 lanes[2];
+  _mm_storeu_pd(lanes, min);
+
+  f64 result = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+  for (; i < n; ++i) {
+    result = x[i] < result ? x[i] : result;
+  }
+
+  return result;
+}
+
+static f64 simdMaxF64Sse2(const f64 *x, u64 n) {
+  __m128d max = _mm_set1_pd(x[0]);
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    max = _mm_max_pd(max, _mm_loadu_pd(x + i));
+  }
+
+  f64 lanes[2];
+  _mm_storeu_pd(lanes, max);
+
+  f64 result = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+  for (; i < n; ++i) {
+    result = x[i] > result ? x[i] : result;
+  }
+
+  return result;
+}
+
+static f64 simdDotF64Sse2(const f64 *x, const f64 *y, u64 n) {
+  __m128d dot0 = _mm_setzero_pd();
+  __m128d dot1 = _mm_setzero_pd();
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    dot0 = _mm_add_pd(dot0, _mm_mul_pd(_mm_loadu_pd(x + i),
+                                       _mm_loadu_pd(y + i)));
+    dot1 = _mm_add_pd(dot1, _mm_mul_pd(_mm_loadu_pd(x + i + 2),
+                                       _mm_loadu_pd(y + i + 2)));
+  }
+
+  f64 lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(dot0, dot1));
+
+  return lanes[0] + lanes[1] + simdDotF64Scalar(x + i, y + i, n - i);
+}
+
+static void simdFill64Sse2(void *x, u64 bits, u64 n) {
+  const __m128i value = _mm_set1_epi64x(bits);
+  u64 *p = x;
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_si128((__m128i *)(p + i), value);
+  }
+
+  simdFill64Scalar(p + i, bits, n - i);
+}
+
+static void simdScaleF64Sse2(f64 *x, f64 a, u64 n) {
+  const __m128d factor = _mm_set1_pd(a);
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(x + i, _mm_mul_pd(_mm_loadu_pd(x + i), factor));
+  }
+
+  simdScaleF64Scalar(x + i, a, n - i);
+}
+
+static void simdAxpyF64Sse2(f64 *y, f64 a, const f64 *x, u64 n) {
+  const __m128d factor = _mm_set1_pd(a);
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d product = _mm_mul_pd(_mm_loadu_pd(x + i), factor);
+    _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), product));
+  }
+
+  simdAxpyF64Scalar(y + i, a, x + i, n - i);
+}
+
+static void simdAddF64Sse2(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(out + i,
+                  _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+
+  simdAddF64Scalar(out + i, x + i, y + i, n - i);
+}
+
+static void simdMulF64Sse2(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(out + i,
+                  _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+
+  simdMulF64Scalar(out + i, x + i, y + i, n - i);
+}
+
+static void simdAddI64Sse2(i64 *out, const i64 *x, const i64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i left = _mm_loadu_si128((const __m128i *)(x + i));
+    __m128i right = _mm_loadu_si128((const __m128i *)(y + i));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_add_epi64(left, right));
+  }
+
+  simdAddI64Scalar(out + i, x + i, y + i, n - i);
+}
+
+/* [a, b] + [0, a] gives the scan of a pair, the carry is the last lane */
+static void simdPrefixSumF64Sse2(f64 *out, const f64 *x, u64 n) {
+  __m128d carry = _mm_setzero_pd();
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d value = _mm_loadu_pd(x + i);
+    value = _mm_add_pd(value, _mm_unpacklo_pd(_mm_setzero_pd(), value));
+    value = _mm_add_pd(value, carry);
+
+    _mm_storeu_pd(out + i, value);
+    carry = _mm_unpackhi_pd(value, value);
+  }
+
+  f64 sum = _mm_cvtsd_f64(carry);
+  for (; i < n; ++i) {
+    sum += x[i];
+    out[i] = sum;
+  }
+}
+
+static void simdPrefixSumI64Sse2(i64 *out, const i64 *x, u64 n) {
+  __m128i carry = _mm_setzero_si128();
+
+  u64 i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i value = _mm_loadu_si128((const __m128i *)(x + i));
+    value = _mm_add_epi64(value, _mm_slli_si128(value, 8));
+    value = _mm_add_epi64(value, carry);
+
+    _mm_storeu_si128((__m128i *)(out + i), value);
+    carry = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 2, 3, 2));
+  }
+
+  u64 sum = (u64)_mm_cvtsi128_si64(carry);
+  for (; i < n; ++i) {
+    sum += (u64)x[i];
+    out[i] = (i64)sum;
+  }
+}
+
+__attribute__((target("avx2"))) static f64 simdSumF64Avx2(const f64 *x,
+                                                          u64 n) {
+  __m256d sum0 = _mm256_setzero_pd();
+  __m256d sum1 = _mm256_setzero_pd();
+
+  u64 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    sum0 = _mm256_add_pd(sum0, _mm256_loadu_pd(x + i));
+    sum1 = _mm256_add_pd(sum1, _mm256_loadu_pd(x + i + 4));
+  }
+
+  f64 lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+         simdSumF64Sse2(x + i, n - i);
+}
+
+__attribute__((target("avx2"))) static i64 simdSumI64Avx2(const i64 *x,
+                                                          u64 n) {
+  __m256i sum = _mm256_setzero_si256();
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    sum = _mm256_add_epi64(sum, _mm256_loadu_si256((const __m256i *)(x + i)));
+  }
+
+  i64 lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, sum);
+
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         simdSumI64Scalar(x + i, n - i);
+}
+
+__attribute__((target("avx2"))) static f64 simdMinF64Avx2(const f64 *x,
+                                                          u64 n) {
+  __m256d min = _mm256_set1_pd(x[0]);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    min = _mm256_min_pd(min, _mm256_loadu_pd(x + i));
+  }
+
+  f64 lanes[4];
+  _mm256_storeu_pd(lanes, min);
+
+  f64 result = simdMinF64Scalar(lanes, 4);
+  for (; i < n; ++i) {
+    result = x[i] < result ? x[i] : result;
+  }
+
+  return result;
+}
+
+__attribute__((target("avx2"))) static f64 simdMaxF64Avx2(const f64 *x,
+                                                          u64 n) {
+  __m256d max = _mm256_set1_pd(x[0]);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    max = _mm256_max_pd(max, _mm256_loadu_pd(x + i));
+  }
+
+  f64 lanes[4];
+  _mm256_storeu_pd(lanes, max);
+
+  f64 result = simdMaxF64Scalar(lanes, 4);
+  for (; i < n; ++i) {
+    result = x[i] > result ? x[i] : result;
+  }
+
+  return result;
+}
+
+__attribute__((target("avx2"))) static i64 simdMinI64Avx2(const i64 *x,
+                                                          u64 n) {
+  __m256i min = _mm256_set1_epi64x(x[0]);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i value = _mm256_loadu_si256((const __m256i *)(x + i));
+    min = _mm256_blendv_epi8(min, value, _mm256_cmpgt_epi64(min, value));
+  }
+
+  i64 lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, min);
+
+  i64 result = simdMinI64Scalar(lanes, 4);
+  for (; i < n; ++i) {
+    result = x[i] < result ? x[i] : result;
+  }
+
+  return result;
+}
+
+__attribute__((target("avx2"))) static i64 simdMaxI64Avx2(const i64 *x,
+                                                          u64 n) {
+  __m256i max = _mm256_set1_epi64x(x[0]);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i value = _mm256_loadu_si256((const __m256i *)(x + i));
+    max = _mm256_blendv_epi8(max, value, _mm256_cmpgt_epi64(value, max));
+  }
+
+  i64 lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, max);
+
+  i64 result = simdMaxI64Scalar(lanes, 4);
+  for (; i < n; ++i) {
+    result = x[i] > result ? x[i] : result;
+  }
+
+  return result;
+}
+
+__attribute__((target("avx2"))) static f64
+simdDotF64Avx2(const f64 *x, const f64 *y, u64 n) {
+  __m256d dot0 = _mm256_setzero_pd();
+  __m256d dot1 = _mm256_setzero_pd();
+
+  u64 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    dot0 = _mm256_add_pd(dot0, _mm256_mul_pd(_mm256_loadu_pd(x + i),
+                                             _mm256_loadu_pd(y + i)));
+    dot1 = _mm256_add_pd(dot1, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4),
+                                             _mm256_loadu_pd(y + i + 4)));
+  }
+
+  f64 lanes[4];
+  _mm256_storeu_pd(lanes, _mm256_add_pd(dot0, dot1));
+
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+         simdDotF64Sse2(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void simdFill64Avx2(void *x, u64 bits,
+                                                           u64 n) {
+  const __m256i value = _mm256_set1_epi64x(bits);
+  u64 *p = x;
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_si256((__m256i *)(p + i), value);
+  }
+
+  simdFill64Scalar(p + i, bits, n - i);
+}
+
+__attribute__((target("avx2"))) static void simdScaleF64Avx2(f64 *x, f64 a,
+                                                             u64 n) {
+  const __m256d factor = _mm256_set1_pd(a);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), factor));
+  }
+
+  simdScaleF64Scalar(x + i, a, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+simdAxpyF64Avx2(f64 *y, f64 a, const f64 *x, u64 n) {
+  const __m256d factor = _mm256_set1_pd(a);
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d product = _mm256_mul_pd(_mm256_loadu_pd(x + i), factor);
+    _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), product));
+  }
+
+  simdAxpyF64Scalar(y + i, a, x + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+simdAddF64Avx2(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(x + i),
+                                            _mm256_loadu_pd(y + i)));
+  }
+
+  simdAddF64Scalar(out + i, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+simdMulF64Avx2(f64 *out, const f64 *x, const f64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i),
+                                            _mm256_loadu_pd(y + i)));
+  }
+
+  simdMulF64Scalar(out + i, x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) static void
+simdAddI64Avx2(i64 *out, const i64 *x, const i64 *y, u64 n) {
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i left = _mm256_loadu_si256((const __m256i *)(x + i));
+    __m256i right = _mm256_loadu_si256((const __m256i *)(y + i));
+    _mm256_storeu_si256((__m256i *)(out + i), _mm256_add_epi64(left, right));
+  }
+
+  simdAddI64Scalar(out + i, x + i, y + i, n - i);
+}
+
+/* log-step scan inside the register: add the value shifted by one lane, then
+ * by two lanes, then the carry broadcast from the previous block */
+__attribute__((target("avx2"))) static void
+simdPrefixSumF64Avx2(f64 *out, const f64 *x, u64 n) {
+  const __m256d zero = _mm256_setzero_pd();
+  __m256d carry = zero;
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d value = _mm256_loadu_pd(x + i);
+
+    __m256d shifted = _mm256_permute4x64_pd(value, _MM_SHUFFLE(2, 1, 0, 0));
+    value = _mm256_add_pd(value, _mm256_blend_pd(shifted, zero, 0x1));
+    value = _mm256_add_pd(value, _mm256_permute2f128_pd(value, value, 0x08));
+    value = _mm256_add_pd(value, carry);
+
+    _mm256_storeu_pd(out + i, value);
+    carry = _mm256_permute4x64_pd(value, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+
+  f64 sum = _mm256_cvtsd_f64(carry);
+  for (; i < n; ++i) {
+    sum += x[i];
+    out[i] = sum;
+  }
+}
+
+__attribute__((target("avx2"))) static void
+simdPrefixSumI64Avx2(i64 *out, const i64 *x, u64 n) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i carry = zero;
+
+  u64 i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i value = _mm256_loadu_si256((const __m256i *)(x + i));
+
+    __m256i shifted =
+        _mm256_permute4x64_epi64(value, _MM_SHUFFLE(2, 1, 0, 0));
+    value = _mm256_add_epi64(value, _mm256_blend_epi32(shifted, zero, 0x03));
+    value = _mm256_add_epi64(value,
+                             _mm256_permute2x128_si256(value, value, 0x08));
+    value = _mm256_add_epi64(value, carry);
+
+    _mm256_storeu_si256((__m256i *)(out + i), value);
+    carry = _mm256_permute4x64_epi64(value, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+
+  u64 sum = (u64)_mm256_extract_epi64(carry, 0);
+  for (; i < n; ++i) {
+    sum += (u64)x[i];
+    out[i] = (i64)sum;
+  }
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "defines.h"
+
+/* kernels are chosen once per process from the cpu features, the scalar
+ * versions are used on targets without sse2/avx2 */
+
+/* index of the first occurrence of needle in haystack, or -1 */
+i64 simdFind(const char *haystack, u64 length, const char *needle,
+             u64 needle_length);
+
+/* lexer scans over source text, each returns the length of the run it
+ * steps over and out_lines the newlines in it */
+/* spaces, tabs, newlines, carriage returns and form feeds */
+u64 simdSpanSpace(const char *s, u64 length, u64 *out_lines);
+/* ascii letters, digits and underscores */
+u64 simdSpanIdent(const char *s, u64 length);
+/* everything before the first a or b */
+u64 simdSpanUntil(const char *s, u64 length, char a, char b, u64 *out_lines);
+
+/* numeric kernels over contiguous i64 and f64 elements. reductions may add
+ * in a different order than a sequential loop. min and max expect n > 0 */
+f64 simdSumF64(const f64 *x, u64 n);
+i64 simdSumI64(const i64 *x, u64 n);
+f64 simdMinF64(const f64 *x, u64 n);
+f64 simdMaxF64(const f64 *x, u64 n);
+i64 simdMinI64(const i64 *x, u64 n);
+i64 simdMaxI64(const i64 *x, u64 n);
+f64 simdDotF64(const f64 *x, const f64 *y, u64 n);
+
+/* fills with a 64-bit pattern, for both i64 and f64 elements */
+void simdFill64(void *x, u64 bits, u64 n);
+void simdScaleF64(f64 *x, f64 a, u64 n);
+/* y = a * x + y */
+void simdAxpyF64(f64 *y, f64 a, const f64 *x, u64 n);
+void simdAddF64(f64 *out, const f64 *x, const f64 *y, u64 n);
+void simdMulF64(f64 *out, const f64 *x, const f64 *y, u64 n);
+void simdAddI64(i64 *out, const i64 *x, const i64 *y, u64 n);
+
+/* inclusive scan, out may alias x */
+void simdPrefixSumF64(f64 *out, const f64 *x, u64 n);
+void simdPrefixSumI64(i64 *out, const i64 *x, u64 n);
@@ -0,0 +1,434 @@
+#include "sort.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX_SIZE (1 << SORT_RADIX_BITS)
+#define SORT_RADIX_PASSES (64 / SORT_RADIX_BITS)
+#define SORT_INSERTION_THRESHOLD 16
+
+typedef struct SortPair {
+  u64 key;
+  i64 index;
+} SortPair;
+
+static void sortRadixHistogram(const i64 *x, u64 n,
+                               u64 counts[SORT_RADIX_PASSES][SORT_RADIX_SIZE]);
+static b8 sortRadixSkip(u64 *counts, u64 n);
+static u64 sortRadixKey(i64 value);
+
+static void sortIntro(f64 *x, u64 n, u32 depth);
+static void sortInsertion(f64 *x, u64 n);
+static void sortHeap(f64 *x, u64 n);
+static void sortSiftDown(f64 *x, u64 root, u64 n);
+static f64 sortMedian(f64 a, f64 b, f64 c);
+static u64 sortPartitionNan(f64 *x, u64 n);
+
+static void argsortIntro(const f64 *x, i64 *indices, u64 n, u32 depth);
+static void argsortInsertion(const f64 *x, i64 *indices, u64 n);
+static void argsortHeap(const f64 *x, i64 *indices, u64 n);
+static void argsortSiftDown(const f64 *x, i64 *indices, u64 root, u64 n);
+static b8 argsortLess(const f64 *x, i64 left, i64 right);
+
+/* one histogram pass for all digits, then a scatter pass per digit. digits
+ * where every key falls in the same bucket are skipped */
+void sortI64(i64 *x, u64 n) {
+  if (n < 2) {
+    return;
+  }
+
+  u64 counts[SORT_RADIX_PASSES][SORT_RADIX_SIZE] = {};
+  sortRadixHistogram(x, n, counts);
+
+  i64 *buffer = malloc(sizeof(i64) * n);
+  i64 *from = x;
+  i64 *to = buffer;
+
+  for (u32 pass = 0; pass < SORT_RADIX_PASSES; ++pass) {
+    if (sortRadixSkip(counts[pass], n)) {
+      continue;
+    }
+
+    u64 offsets[SORT_RADIX_SIZE];
+    u64 offset = 0;
+    for (u32 i = 0; i < SORT_RADIX_SIZE; ++i) {
+      offsets[i] = offset;
+      offset += counts[pass][i];
+    }
+
+    u32 shift = pass * SORT_RADIX_BITS;
+    for (u64 i = 0; i < n; ++i) {
+      u64 digit = (sortRadixKey(from[i]) >> shift) & (SORT_RADIX_SIZE - 1);
+      to[offsets[digit]++] = from[i];
+    }
+
+    i64 *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != x) {
+    memcpy(x, from, sizeof(i64) * n);
+  }
+
+  free(buffer);
+}
+
+/* a single counting pass is the whole radix sort for bytes */
+void sortChar(char *x, u64 n) {
+  u64 counts[SORT_RADIX_SIZE] = {};
+  for (u64 i = 0; i < n; ++i) {
+    counts[(u8)(x[i] ^ 0x80)]++;
+  }
+
+  u64 position = 0;
+  for (u32 i = 0; i < SORT_RADIX_SIZE; ++i) {
+    memset(x + position, (char)(i ^ 0x80), counts[i]);
+    position += counts[i];
+  }
+}
+
+void sortF64(f64 *x, u64 n) {
+  /* NaNs compare false with everything, keep them out of the partitions */
+  n = sortPartitionNan(x, n);
+
+  u32 depth = 0;
+  for (u64 i = n; i > 1; i >>= 1) {
+    depth += 2;
+  }
+
+  sortIntro(x, n, depth);
+}
+
+void argsortI64(const i64 *x, i64 *indices, u64 n) {
+  if (n == 0) {
+    return;
+  }
+
+  u64 counts[SORT_RADIX_PASSES][SORT_RADIX_SIZE] = {};
+  sortRadixHistogram(x, n, counts);
+
+  SortPair *pairs = malloc(sizeof(SortPair) * n * 2);
+  SortPair *from = pairs;
+  SortPair *to = pairs + n;
+  for (u64 i = 0; i < n; ++i) {
+    from[i].key = sortRadixKey(x[i]);
+    from[i].index = i;
+  }
+
+  /* every pass is stable, so equal keys keep their original order */
+  for (u32 pass = 0; pass < SORT_RADIX_PASSES; ++pass) {
+    if (sortRadixSkip(counts[pass], n)) {
+      continue;
+    }
+
+    u64 offsets[SORT_RADIX_SIZE];
+    u64 offset = 0;
+    for (u32 i = 0; i < SORT_RADIX_SIZE; ++i) {
+      offsets[i] = offset;
+      offset += counts[pass][i];
+    }
+
+    u32 shift = pass * SORT_RADIX_BITS;
+    for (u64 i = 0; i < n; ++i) {
+      u64 digit = (from[i].key >> shift) & (SORT_RADIX_SIZE - 1);
+      to[offsets[digit]++] = from[i];
+    }
+
+    SortPair *swap = from;
+    from = to;
+    to = swap;
+  }
+
+  for (u64 i = 0; i < n; ++i) {
+    indices[i] = from[i].index;
+  }
+
+  free(pairs);
+}
+
+void argsortChar(const char *x, i64 *indices, u64 n) {
+  u64 offsets[SORT_RADIX_SIZE] = {};
+  for (u64 i = 0; i < n; ++i) {
+    offsets[(u8)(x[i] ^ 0x80)]++;
+  }
+
+  u64 offset = 0;
+  for (u32 i = 0; i < SORT_RADIX_SIZE; ++i) {
+    u64 count = offsets[i];
+    offsets[i] = offset;
+    offset += count;
+  }
+
+  for (u64 i = 0; i < n; ++i) {
+    indices[offsets[(u8)(x[i] ^ 0x80)]++] = i;
+  }
+}
+
+/* ties are broken by index, which makes the unstable introsort stable */
+void argsortF64(const f64 *x, i64 *indices, u64 n) {
+  for (u64 i = 0; i < n; ++i) {
+    indices[i] = i;
+  }
+
+  u32 depth = 0;
+  for (u64 i = n; i > 1; i >>= 1) {
+    depth += 2;
+  }
+
+  argsortIntro(x, indices, n, depth);
+}
+
+static void sortRadixHistogram(const i64 *x, u64 n,
+                               u64 counts[SORT_RADIX_PASSES][SORT_RADIX_SIZE]) {
+  for (u64 i = 0; i < n; ++i) {
+    u64 key = sortRadixKey(x[i]);
+    for (u32 pass = 0; pass < SORT_RADIX_PASSES; ++pass) {
+      counts[pass][(key >> (pass * SORT_RADIX_BITS)) & (SORT_RADIX_SIZE - 1)]++;
+    }
+  }
+}
+
+static b8 sortRadixSkip(u64 *counts, u64 n) {
+  for (u32 i = 0; i < SORT_RADIX_SIZE; ++i) {
+    if (counts[i] == n) {
+      return true;
+    }
+    if (counts[i] != 0) {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+/* flipping the sign bit orders negative numbers before positive ones */
+static u64 sortRadixKey(i64 value) {
+  return (u64)value ^ ((u64)1 << 63);
+}
+
+static void sortIntro(f64 *x, u64 n, u32 depth) {
+  while (n > SORT_INSERTION_THRESHOLD) {
+    if (depth == 0) {
+      sortHeap(x, n);
+      return;
+    }
+    depth--;
+
+    f64 pivot = sortMedian(x[0], x[n / 2], x[n - 1]);
+
+    /* hoare partition, the median of three keeps both scans in bounds */
+    i64 i = -1;
+    i64 j = n;
+    for (;;) {
+      do {
+        i++;
+      } while (x[i] < pivot);
+      do {
+        j--;
+      } while (x[j] > pivot);
+
+      if (i >= j) {
+        break;
+      }
+
+      f64 swap = x[i];
+      x[i] = x[j];
+      x[j] = swap;
+    }
+
+    /* recurse into the smaller side, loop on the larger one */
+    u64 left = j + 1;
+    if (left < n - left) {
+      sortIntro(x, left, depth);
+      x += left;
+      n -= left;
+    } else {
+      sortIntro(x + left, n - left, depth);
+      n = left;
+    }
+  }
+
+  sortInsertion(x, n);
+}
+
+static void sortInsertion(f64 *x, u64 n) {
+  for (u64 i = 1; i < n; ++i) {
+    f64 value = x[i];
+    u64 j = i;
+    while (j > 0 && x[j - 1] > value) {
+      x[j] = x[j - 1];
+      j--;
+    }
+    x[j] = value;
+  }
+}
+
+static void sortHeap(f64 *x, u64 n) {
+  for (u64 i = n / 2; i > 0; --i) {
+    sortSiftDown(x, i - 1, n);
+  }
+
+  for (u64 end = n - 1; end > 0; --end) {
+    f64 swap = x[0];
+    x[0] = x[end];
+    x[end] = swap;
+
+    sortSiftDown(x, 0, end);
+  }
+}
+
+static void sortSiftDown(f64 *x, u64 root, u64 n) {
+  for (;;) {
+    u64 child = root * 2 + 1;
+    if (child >= n) {
+      return;
+    }
+    if (child + 1 < n && x[child + 1] > x[child]) {
+      child++;
+    }
+    if (!(x[child] > x[root])) {
+      return;
+    }
+
+    f64 swap = x[root];
+    x[root] = x[child];
+    x[child] = swap;
+    root = child;
+  }
+}
+
+static f64 sortMedian(f64 a, f64 b, f64 c) {
+  if (a < b) {
+    return b < c ? b : (a < c ? c : a);
+  }
+
+  return a < c ? a : (b < c ? c : b);
+}
+
+/* moves the NaNs to the end, returns the number of other elements */
+static u64 sortPartitionNan(f64 *x, u64 n) {
+  u64 count = 0;
+  for (u64 i = 0; i < n; ++i) {
+    if (!isnan(x[i])) {
+      f64 swap = x[count];
+      x[count++] = x[i];
+      x[i] = swap;
+    }
+  }
+
+  return count;
+}
+
+static void argsortIntro(const f64 *x, i64 *indices, u64 n, u32 depth) {
+  while (n > SORT_INSERTION_THRESHOLD) {
+    if (depth == 0) {
+      argsortHeap(x, indices, n);
+      return;
+    }
+    depth--;
+
+    i64 a = indices[0];
+    i64 b = indices[n / 2];
+    i64 c = indices[n - 1];
+    i64 pivot;
+    if (argsortLess(x, a, b)) {
+      pivot = argsortLess(x, b, c) ? b : (argsortLess(x, a, c) ? c : a);
+    } else {
+      pivot = argsortLess(x, a, c) ? a : (argsortLess(x, b, c) ? c : b);
+    }
+
+    i64 i = -1;
+    i64 j = n;
+    for (;;) {
+      do {
+        i++;
+      } while (argsortLess(x, indices[i], pivot));
+      do {
+        j--;
+      } while (argsortLess(x, pivot, indices[j]));
+
+      if (i >= j) {
+        break;
+      }
+
+      i64 swap = indices[i];
+      indices[i] = indices[j];
+      indices[j] = swap;
+    }
+
+    u64 left = j + 1;
+    if (left < n - left) {
+      argsortIntro(x, indices, left, depth);
+      indices += left;
+      n -= left;
+    } else {
+      argsortIntro(x, indices + left, n - left, depth);
+      n = left;
+    }
+  }
+
+  argsortInsertion(x, indices, n);
+}
+
+static void argsortInsertion(const f64 *x, i64 *indices, u64 n) {
+  for (u64 i = 1; i < n; ++i) {
+    i64 value = indices[i];
+    u64 j = i;
+    while (j > 0 && argsortLess(x, value, indices[j - 1])) {
+      indices[j] = indices[j - 1];
+      j--;
+    }
+    indices[j] = value;
+  }
+}
+
+static void argsortHeap(const f64 *x, i64 *indices, u64 n) {
+  for (u64 i = n / 2; i > 0; --i) {
+    argsortSiftDown(x, indices, i - 1, n);
+  }
+
+  for (u64 end = n - 1; end > 0; --end) {
+    i64 swap = indices[0];
+    indices[0] = indices[end];
+    indices[end] = swap;
+
+    argsortSiftDown(x, indices, 0, end);
+  }
+}
+
+static void argsortSiftDown(const f64 *x, i64 *indices, u64 root, u64 n) {
+  for (;;) {
+    u64 child = root * 2 + 1;
+    if (child >= n) {
+      return;
+    }
+    if (child + 1 < n && argsortLess(x, indices[child], indices[child + 1])) {
+      child++;
+    }
+    if (!argsortLess(x, indices[root], indices[child])) {
+      return;
+    }
+
+    i64 swap = indices[root];
+    indices[root] = indices[child];
+    indices[child] = swap;
+    root = child;
+  }
+}
+
+/* total order: numbers ascending, NaNs last, equal keys by index */
+static b8 argsortLess(const f64 *x, i64 left, i64 right) {
+  b8 left_nan = isnan(x[left]);
+  b8 right_nan = isnan(x[right]);
+  if (left_nan != right_nan) {
+    return right_nan;
+  }
+  if (!left_nan && x[left] != x[right]) {
+    return x[left] < x[right];
+  }
+
+  return left < right;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "defines.h"
+
+/* in place ascending sorts. integers use an lsd radix sort, floats an
+ * introsort with NaNs placed last */
+void sortI64(i64 *x, u64 n);
+void sortChar(char *x, u64 n);
+void sortF64(f64 *x, u64 n);
+
+/* fills indices with the stable ascending order of x */
+void argsortI64(const i64 *x, i64 *indices, u64 n);
+void argsortChar(const char *x, i64 *indices, u64 n);
+void argsortF64(const f64 *x, i64 *indices, u64 n);
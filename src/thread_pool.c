@@ -0,0 +1,368 @@
+#include "thread_pool.h"
+
+#include "logger.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define THREAD_DEQUE_DEFAULT_CAPACITY 64
+#define THREAD_WAIT_NANOSECONDS 1000000
+/* upper bound with the workers started for blocked ones */
+#define THREAD_POOL_MAX_SIZE 256
+
+typedef struct ThreadTask {
+  ThreadTaskFun run;
+  void *data;
+  ThreadGroup *group;
+} ThreadTask;
+
+/* the owner pushes and pops at the bottom, thieves take from the top. the
+ * lock is per worker, so it is only contended by a steal */
+typedef struct ThreadDeque {
+  pthread_mutex_t lock;
+  ThreadTask *tasks;
+  u64 capacity;
+  u64 top;
+  u64 bottom;
+} ThreadDeque;
+
+typedef struct ThreadWorker {
+  pthread_t thread;
+  ThreadDeque deque;
+  u32 index;
+} ThreadWorker;
+
+typedef struct ThreadPool {
+  ThreadWorker *workers;
+  u32 size;
+  /* workers waiting in a block, see threadPoolBlockBegin */
+  u32 blocked;
+  /* tasks in all deques, workers sleep while it is zero */
+  u64 queued;
+  /* tasks submitted and not finished yet */
+  u64 active;
+  b8 started;
+  u32 next;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+} ThreadPool;
+
+static void threadPoolStart();
+static void threadPoolForked();
+static void threadPoolGrow();
+static void threadWorkerStart(u32 index);
+static void *threadWorkerMain(void *data);
+static b8 threadPoolRunOne(ThreadWorker *self);
+static void threadTaskRun(ThreadTask *task);
+
+static void threadDequeCreate(ThreadDeque *deque);
+static void threadDequePush(ThreadDeque *deque, ThreadTask *task);
+static b8 threadDequePop(ThreadDeque *deque, ThreadTask *out_task);
+static b8 threadDequeSteal(ThreadDeque *deque, ThreadTask *out_task);
+
+static ThreadPool pool = {};
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+/* worker of the current thread, null outside the pool */
+static _Thread_local ThreadWorker *thread_worker = 0;
+
+void threadGroupCreate(ThreadGroup *out_group) {
+  out_group->pending = 0;
+  out_group->error = 0;
+  pthread_mutex_init(&out_group->lock, 0);
+  pthread_cond_init(&out_group->done, 0);
+}
+
+void threadGroupDestroy(ThreadGroup *group) {
+  pthread_mutex_destroy(&group->lock);
+  pthread_cond_destroy(&group->done);
+  free(group->error);
+}
+
+u32 threadPoolSize() {
+  pthread_once(&pool_once, threadPoolStart);
+
+  return __atomic_load_n(&pool.size, __ATOMIC_ACQUIRE);
+}
+
+void threadPoolSubmit(ThreadGroup *group, ThreadTaskFun run, void *data) {
+  pthread_once(&pool_once, threadPoolStart);
+
+  ThreadTask task = {};
+  task.run = run;
+  task.data = data;
+  task.group = group;
+
+  __atomic_add_fetch(&group->pending, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&pool.active, 1, __ATOMIC_RELAXED);
+
+  ThreadWorker *worker = thread_worker;
+  if (!worker) {
+    u32 next = __atomic_fetch_add(&pool.next, 1, __ATOMIC_RELAXED);
+    worker = &pool.workers[next % threadPoolSize()];
+  }
+
+  threadDequePush(&worker->deque, &task);
+  __atomic_add_fetch(&pool.queued, 1, __ATOMIC_SEQ_CST);
+
+  /* taking the lock orders the wake after a sleeper has checked queued */
+  pthread_mutex_lock(&pool.lock);
+  pthread_cond_signal(&pool.wake);
+  pthread_mutex_unlock(&pool.lock);
+}
+
+void threadPoolWait(ThreadGroup *group) {
+  pthread_once(&pool_once, threadPoolStart);
+
+  while (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+    if (threadPoolRunOne(thread_worker)) {
+      continue;
+    }
+
+    /* nothing to steal, the last tasks run elsewhere. the timeout picks up
+     * tasks those spawn in the meantime */
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += THREAD_WAIT_NANOSECONDS;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&group->lock);
+    if (__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0) {
+      pthread_cond_timedwait(&group->done, &group->lock, &deadline);
+    }
+    pthread_mutex_unlock(&group->lock);
+  }
+
+  pthread_mutex_lock(&group->lock);
+  pthread_mutex_unlock(&group->lock);
+}
+
+void threadPoolJoin() {
+  if (!__atomic_load_n(&pool.started, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
+  while (__atomic_load_n(&pool.active, __ATOMIC_ACQUIRE) > 0) {
+    if (!threadPoolRunOne(thread_worker)) {
+      struct timespec pause = {0, THREAD_WAIT_NANOSECONDS};
+      nanosleep(&pause, 0);
+    }
+  }
+}
+
+void threadPoolBlockBegin() {
+  pthread_once(&pool_once, threadPoolStart);
+
+  if (!thread_worker) {
+    return;
+  }
+
+  u32 blocked = __atomic_add_fetch(&pool.blocked, 1, __ATOMIC_SEQ_CST);
+  if (blocked >= threadPoolSize()) {
+    threadPoolGrow();
+  }
+}
+
+void threadPoolBlockEnd() {
+  if (!thread_worker) {
+    return;
+  }
+
+  __atomic_sub_fetch(&pool.blocked, 1, __ATOMIC_SEQ_CST);
+}
+
+static void threadPoolStart() {
+  /* the thread waiting on a group helps, so one cpu is left for it */
+  i64 size = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+
+  char *threads = getenv("LIV_THREADS");
+  if (threads) {
+    size = atol(threads);
+  }
+  if (size < 1) {
+    size = 1;
+  }
+
+  if (size > THREAD_POOL_MAX_SIZE / 2) {
+    size = THREAD_POOL_MAX_SIZE / 2;
+  }
+
+  /* the slots are allocated up front, so a started worker never moves */
+  pool.workers = calloc(THREAD_POOL_MAX_SIZE, sizeof(ThreadWorker));
+  pthread_mutex_init(&pool.lock, 0);
+  pthread_cond_init(&pool.wake, 0);
+
+  for (u32 i = 0; i < size; ++i) {
+    threadWorkerStart(i);
+  }
+
+  pthread_atfork(0, 0, threadPoolForked);
+  __atomic_store_n(&pool.started, true, __ATOMIC_RELEASE);
+}
+
+/* the workers do not survive a fork, the child starts a pool of its own on
+ * first use. the old one is abandoned, its locks may be held by them */
+static void threadPoolForked() {
+  ThreadPool empty = {};
+  pool = empty;
+
+  pthread_once_t once = PTHREAD_ONCE_INIT;
+  pool_once = once;
+}
+
+static void threadPoolGrow() {
+  pthread_mutex_lock(&pool.lock);
+
+  /* another blocked worker may have grown the pool meanwhile */
+  u32 index = pool.size;
+  if (index < THREAD_POOL_MAX_SIZE &&
+      __atomic_load_n(&pool.blocked, __ATOMIC_SEQ_CST) >= index) {
+    threadWorkerStart(index);
+  }
+
+  pthread_mutex_unlock(&pool.lock);
+}
+
+static void threadWorkerStart(u32 index) {
+  ThreadWorker *worker = &pool.workers[index];
+  worker->index = index;
+  threadDequeCreate(&worker->deque);
+
+  if (pthread_create(&worker->thread, 0, threadWorkerMain, worker)) {
+    FATAL("liv: failed to start a worker thread!");
+    exit(1);
+  }
+  pthread_detach(worker->thread);
+
+  __atomic_store_n(&pool.size, index + 1, __ATOMIC_RELEASE);
+}
+
+static void *threadWorkerMain(void *data) {
+  thread_worker = data;
+
+  for (;;) {
+    if (threadPoolRunOne(thread_worker)) {
+      continue;
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    while (__atomic_load_n(&pool.queued, __ATOMIC_SEQ_CST) == 0) {
+      pthread_cond_wait(&pool.wake, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+  }
+
+  return 0;
+}
+
+/* own deque first, then steal round the others starting after self */
+static b8 threadPoolRunOne(ThreadWorker *self) {
+  ThreadTask task;
+
+  if (self && threadDequePop(&self->deque, &task)) {
+    threadTaskRun(&task);
+    return true;
+  }
+
+  u32 size = __atomic_load_n(&pool.size, __ATOMIC_ACQUIRE);
+  u32 start = self ? self->index + 1 : 0;
+  for (u32 i = 0; i < size; ++i) {
+    ThreadWorker *victim = &pool.workers[(start + i) % size];
+    if (victim != self && threadDequeSteal(&victim->deque, &task)) {
+      threadTaskRun(&task);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void threadTaskRun(ThreadTask *task) {
+  __atomic_sub_fetch(&pool.queued, 1, __ATOMIC_SEQ_CST);
+
+  ThreadGroup *group = task->group;
+
+  ErrorTrap trap;
+  errorTrapPush(&trap);
+  if (setjmp(trap.jump) == 0) {
+    task->run(task->data);
+    errorTrapPop(&trap);
+  } else {
+    pthread_mutex_lock(&group->lock);
+    if (!group->error) {
+      group->error = malloc(sizeof(Error));
+      *group->error = trap.error;
+    }
+    pthread_mutex_unlock(&group->lock);
+  }
+
+  /* the last task signals under the lock, the waiter takes the lock before
+   * returning so the group is not destroyed under this thread */
+  pthread_mutex_lock(&group->lock);
+  if (__atomic_sub_fetch(&group->pending, 1, __ATOMIC_RELEASE) == 0) {
+    pthread_cond_broadcast(&group->done);
+  }
+  pthread_mutex_unlock(&group->lock);
+
+  __atomic_sub_fetch(&pool.active, 1, __ATOMIC_RELEASE);
+}
+
+static void threadDequeCreate(ThreadDeque *deque) {
+  pthread_mutex_init(&deque->lock, 0);
+  deque->capacity = THREAD_DEQUE_DEFAULT_CAPACITY;
+  deque->tasks = malloc(sizeof(ThreadTask) * deque->capacity);
+  deque->top = 0;
+  deque->bottom = 0;
+}
+
+static void threadDequePush(ThreadDeque *deque, ThreadTask *task) {
+  pthread_mutex_lock(&deque->lock);
+
+  /* top and bottom only grow, the slots are taken modulo the capacity */
+  if (deque->bottom - deque->top == deque->capacity) {
+    ThreadTask *tasks = malloc(sizeof(ThreadTask) * deque->capacity * 2);
+    for (u64 i = deque->top; i < deque->bottom; ++i) {
+      tasks[i % (deque->capacity * 2)] = deque->tasks[i % deque->capacity];
+    }
+
+    free(deque->tasks);
+    deque->tasks = tasks;
+    deque->capacity *= 2;
+  }
+
+  deque->tasks[deque->bottom % deque->capacity] = *task;
+  deque->bottom++;
+
+  pthread_mutex_unlock(&deque->lock);
+}
+
+static b8 threadDequePop(ThreadDeque *deque, ThreadTask *out_task) {
+  pthread_mutex_lock(&deque->lock);
+
+  b8 found = deque->bottom > deque->top;
+  if (found) {
+    deque->bottom--;
+    *out_task = deque->tasks[deque->bottom % deque->capacity];
+  }
+
+  pthread_mutex_unlock(&deque->lock);
+
+  return found;
+}
+
+static b8 threadDequeSteal(ThreadDeque *deque, ThreadTask *out_task) {
+  pthread_mutex_lock(&deque->lock);
+
+  b8 found = deque->bottom > deque->top;
+  if (found) {
+    *out_task = deque->tasks[deque->top % deque->capacity];
+    deque->top++;
+  }
+
+  pthread_mutex_unlock(&deque->lock);
+
+  return found;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "defines.h"
+#include "error.h"
+
+#include <pthread.h>
+
+typedef void (*ThreadTaskFun)(void *data);
+
+/* tasks submitted under one group are joined together. a task that raises
+ * an error stops there, the first error is kept for the joining thread */
+typedef struct ThreadGroup {
+  u64 pending;
+  pthread_mutex_t lock;
+  pthread_cond_t done;
+  Error *error;
+} ThreadGroup;
+
+void threadGroupCreate(ThreadGroup *out_group);
+void threadGroupDestroy(ThreadGroup *group);
+
+/* number of worker threads, the pool is started on first use. LIV_THREADS
+ * overrides the size taken from the number of cpus */
+u32 threadPoolSize();
+
+/* a worker pushes to its own deque, other threads spread the tasks over
+ * the workers */
+void threadPoolSubmit(ThreadGroup *group, ThreadTaskFun run, void *data);
+/* runs or steals other tasks until every task of the group has finished */
+void threadPoolWait(ThreadGroup *group);
+/* waits for every submitted task, also those nobody joins. does nothing
+ * when the pool was never started */
+void threadPoolJoin();
+
+/* brackets a wait on something another task has to provide. when every
+ * worker is blocked the pool starts one more, so queued tasks still run */
+void threadPoolBlockBegin();
+void threadPoolBlockEnd();
@@ -1,7 +1,6 @@
 #pragma once
 
 #include "defines.h"
-#include "interpreter_value.h"
 
 typedef enum TokenType {
   TOKEN_TYPE_NONE = 0,
@@ -57,6 +56,8 @@ typedef enum TokenType {
   TOKEN_TYPE_ARROW,
   /* . */
   TOKEN_TYPE_DOT,
+  /* .. */
+  TOKEN_TYPE_DOTDOT,
   /* ! */
   TOKEN_TYPE_EXMARK,
   /* { */
@@ -77,6 +78,8 @@ typedef enum TokenType {
   TOKEN_TYPE_VAR,
   /* fun keyword */
   TOKEN_TYPE_FUN,
+  /* struct keyword */
+  TOKEN_TYPE_STRUCT,
   /* if keyword */
   TOKEN_TYPE_IF,
   /* else keyword */
@@ -85,6 +88,16 @@ typedef enum TokenType {
   TOKEN_TYPE_WHILE,
   /* for keyword */
   TOKEN_TYPE_FOR,
+  /* pfor keyword */
+  TOKEN_TYPE_PFOR,
+  /* spawn keyword */
+  TOKEN_TYPE_SPAWN,
+  /* await keyword */
+  TOKEN_TYPE_AWAIT,
+  /* yield keyword */
+  TOKEN_TYPE_YIELD,
+  /* in keyword */
+  TOKEN_TYPE_IN,
   /* return keyword */
   TOKEN_TYPE_RETURN,
   /* break keyword */
@@ -106,11 +119,19 @@ typedef enum TokenType {
   TOKEN_TYPE_MAX,
 } TokenType;
 
+/* a span of the source the token was lexed from, which has to outlive it.
+ * a string or char literal spans what is between its quotes, escapes and
+ * all, a number its text with the sign. the offset is 40 bits, split so the
+ * record stays at 12 bytes: sources can be up to 1 TB and a token up to
+ * 64 KB */
 typedef struct Token {
+  u32 offset;
+  u32 line;
+  u16 length;
   u8 type;
-  InterpreterValue value;
+  u8 offset_high;
 } Token;
-;
-void tokenDestroy(Token *token);
 
-void tokenPrint(Token *token);
+u64 tokenOffset(Token *token);
+
+void tokenPrint(const char *source, Token *token);